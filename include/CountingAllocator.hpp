@@ -0,0 +1,39 @@
+/**
+ * @file CountingAllocator.hpp
+ * @author Isaac Fonseca (isaac.fonsecasegura@ucr.ac.cr)
+ * @date 2026-10-16
+ *
+ */
+
+#ifndef COUNTING_ALLOCATOR_HPP_
+#define COUNTING_ALLOCATOR_HPP_
+
+#include <atomic>
+#include "opencv2/core/core.hpp"
+
+using namespace cv;
+
+/**
+ * @brief OpenCV matrix allocator that counts the buffers it allocates and forwards every call to the allocator it
+ * replaces. Once installed as the default allocator every Mat buffer of the process goes through it, the frame
+ * workspace misses as well as the scratch images of the filters and of OpenCV itself, so the difference of two
+ * readings is the number of Mat buffers allocated in between. Other heap allocations are not seen
+ *
+ */
+class CountingAllocator : public MatAllocator {
+	public:
+		static void Install();
+		static unsigned long Allocations();
+
+		UMatData *allocate(int dims, const int *sizes, int type, void *data, size_t *step, AccessFlag flags, UMatUsageFlags usageFlags) const override;
+		bool allocate(UMatData *data, AccessFlag accessFlags, UMatUsageFlags usageFlags) const override;
+		void deallocate(UMatData *data) const override;
+
+	private:
+		CountingAllocator(MatAllocator *wrapped);
+
+		MatAllocator *wrapped; // Allocator that owns the buffers
+		static std::atomic<unsigned long> allocations;
+};
+
+#endif /* COUNTING_ALLOCATOR_HPP_ */
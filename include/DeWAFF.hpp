@@ -13,6 +13,9 @@
 #include "opencv2/highgui/highgui.hpp"
 #include "Utils.hpp"
 #include "Filters.hpp"
+#include "TemporalTiles.hpp"
+#include "LabImage.hpp"
+#include <functional>
 
 using namespace cv;
 
@@ -25,14 +28,19 @@ using namespace cv;
 class DeWAFF {
 	private:
 		Utils utilsLib;
-		Filters filtersLib;
+		LabImage temporalOutput; // Output of the previous frame, reused on its unchanged tiles
+		float temporalScale; // USM scale of the last frame filtered whole
+		LabImage TemporalFilter(const LabImage &usmImage, const LabImage &inputImage, int usmRadius, int halo, const std::function<LabImage(const LabImage&, const LabImage&)> &filter);
 	public:
 		DeWAFF();
+		Filters filtersLib; /// Filters library, exposed to configure how the filters are evaluated
 		double usmLambda; /// Parameter for the Laplacian deceive
-		Mat DeceivedBilateralFilter(const Mat &inputImage, int windowSize, double spatialSigma, double rangeSigma);
-		Mat DeceivedScaledBilateralFilter(const Mat &inputImage, int windowSize, double spatialSigma, double rangeSigma);
-		Mat DeceivedNonLocalMeansFilter(const Mat &inputImage, int windowSize, int neighborhoodSize, double spatialSigma, double rangeSigma);
-		Mat DeceivedGuidedFilter(const Mat &inputImage, int windowSize, double spatialSigma, double rangeSigma);
+		TemporalTiles *temporalTiles; /// Changed tiles of the current video frame, null filters every frame whole
+		void SetWorkspace(FrameWorkspace *workspace);
+		LabImage DeceivedBilateralFilter(const LabImage &inputImage, int windowSize, double spatialSigma, double rangeSigma);
+		LabImage DeceivedScaledBilateralFilter(const LabImage &inputImage, int windowSize, double spatialSigma, double rangeSigma);
+		LabImage DeceivedNonLocalMeansFilter(const LabImage &inputImage, int windowSize, int neighborhoodSize, double spatialSigma, double rangeSigma);
+		LabImage DeceivedGuidedFilter(const LabImage &inputImage, int windowSize, double spatialSigma, double rangeSigma);
 };
 
 #endif /* DEWAFF_H_ */
@@ -13,30 +13,66 @@
 #define FILTERS_HPP_
 
 #include <omp.h>
+#include <unistd.h>
 #include <opencv2/opencv.hpp>
 #include "opencv2/core/core.hpp"
 #include "opencv2/imgproc/imgproc.hpp"
 #include "opencv2/highgui/highgui.hpp"
 #include "Utils.hpp"
 #include "GuidedFilter.hpp"
+#include "Kernels.hpp"
+#include "PermutohedralLattice.hpp"
+#include "FrameWorkspace.hpp"
+#include "LabImage.hpp"
 
 using namespace cv;
 
 /**
- * @brief Class containing Weighted Average Filters (WAFs). This implementation relies on padding the original image to fit
- * square odd dimensioned kernels throughout the processing
+ * @brief Class containing Weighted Average Filters (WAFs). The filters use square odd dimensioned kernels throughout the
+ * processing, the pixels outside of the image are taken as zeros by the kernels without padded copies of the image.
+ * The images are planar CIELab images, which the filters read and write plane by plane
  *
  */
 class Filters {
 	private:
 		enum CIELab : int {L, a, b}; // CIELab channels
 		Utils utilsLib;
+		GaussianLUT rangeTable; // Range kernel lookup table, kept across frames
+		PermutohedralLattice lattice; // Lattice of the grid engine, its tables are kept across frames
+		unsigned long prunedCandidates, comparedCandidates; // Patch pre-selection counters of the NLM filter
+
+		LabImage LatticeBilateralFilter(const LabImage &inputImage, const LabImage &weightingImage, double spatialSigma, double rangeSigma);
+		LabImage TrigonometricBilateralFilter(const LabImage &inputImage, const LabImage &weightingImage, int windowSize, double spatialSigma, double rangeSigma);
+		void SymmetricBilateralFilter(const BilateralArgs &args, LabImage &outputImage);
+		void SlidingNonLocalMeansFilter(const NonLocalMeansArgs &args, const LabImage &weightingImage, int windowSize, int neighborhoodSize, LabImage &outputImage);
+		LabImage PCANonLocalMeansFilter(const LabImage &inputImage, const LabImage &weightingImage, int windowSize, int neighborhoodSize, double rangeSigma);
+		LabImage IntegralNonLocalMeansFilter(const LabImage &inputImage, const LabImage &weightingImage, int windowSize, int neighborhoodSize, double rangeSigma);
+		void RaisedCosineTerms(double range, double rangeSigma, double tolerance, std::vector<int> &harmonics, std::vector<double> &coefficients, double &frequency);
 
 	public:
-		Mat BilateralFilter(const Mat &inputImage, const Mat &weightingImage, int windowSize, double spatialSigma, double rangeSigma);
-		Mat ScaledBilateralFilter(const Mat &inputImage, const Mat &weightingImage, int windowSize, double spatialSigma, double rangeSigma);
-		Mat NonLocalMeansFilter(const Mat &inputImage, const Mat &weightingImage, int windowSize, int neighborhoodSize, double rangeSigma);
-		Mat GuidedFilter(const Mat &inputImage, const Mat &guidingImage, int windowSize, double rangeSigma);
+		Filters();
+		static const int AUTO_TILE = -1; // Derive the tile size from the L2 cache size
+		static const int MAX_TRIGONOMETRIC_TERMS = 512; // Largest expansion accepted by the trigonometric engine
+		static const int PCA_SAMPLES = 10000; // Approximate number of patches sampled to learn the PCA basis
+		enum Engine : int {EXACT, GRID, TRIG, INTEGRAL, SLIDING, PCA}; // Evaluation engines of the filters
+		Engine engine; /// Engine used by the bilateral and non local means filters
+		float gridResolution; /// Lattice points per standard deviation of the grid engine, in (0, 1]
+		double trigTolerance; /// Largest range kernel error of the trigonometric engine, in (0, 1)
+		int pcaDimensions; /// Patch descriptor dimensions of the PCA engine
+		bool rangeLUT; /// Evaluate the range kernels through a lookup table instead of the exponential
+		bool symmetric; /// Evaluate each pair of pixels once and accumulate it into both of them
+		double pruneThreshold; /// Relative NLM weight under which the candidate patches are discarded by their moments, 0 disables it
+		double PrunedFraction() const;
+		void ResetPruningCounters();
+		void MergePruningCounters(Filters &other);
+		int tileSize; /// Side of the square output tiles of the bilateral filters, 0 processes whole rows
+		int guidedSubsampling; /// Subsampling factor of the guided filter coefficients, 1 runs it at full resolution
+		FrameWorkspace *workspace; /// Buffers reused across frames, null allocates them on every call
+		int TileSize(int windowSize) const;
+		LabImage BilateralFilter(const LabImage &inputImage, const LabImage &weightingImage, int windowSize, double spatialSigma, double rangeSigma);
+		LabImage ScaledBilateralFilter(const LabImage &inputImage, const LabImage &weightingImage, int windowSize, double spatialSigma, double rangeSigma);
+		LabImage NonLocalMeansFilter(const LabImage &inputImage, const LabImage &weightingImage, int windowSize, int neighborhoodSize, double rangeSigma);
+		LabImage GuidedFilter(const LabImage &inputImage, const LabImage &guidingImage, int windowSize, double rangeSigma);
 };
 
 #endif /* FILTERS_HPP_ */
\ No newline at end of file
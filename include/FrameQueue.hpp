@@ -0,0 +1,76 @@
+/**
+ * @file FrameQueue.hpp
+ * @author Isaac Fonseca (isaac.fonsecasegura@ucr.ac.cr)
+ * @date 2026-10-16
+ *
+ */
+
+#ifndef FRAME_QUEUE_HPP_
+#define FRAME_QUEUE_HPP_
+
+#include <atomic>
+#include <vector>
+#include <cstddef>
+
+/**
+ * @brief Bounded lock free queue between one producer thread and one consumer thread, used to connect the stages
+ * of the video pipeline. The items live in a ring with one spare slot, the producer only writes the tail and the
+ * consumer only writes the head, so each index is published with a release store and read with an acquire load.
+ * A full or empty queue blocks the caller on the index written by the other side, which notifies it after every
+ * store, so an idle stage sleeps instead of spinning
+ *
+ */
+template <typename T>
+class FrameQueue {
+	public:
+		FrameQueue(std::size_t depth);
+		void Push(const T &item);
+		T Pop();
+
+	private:
+		static const std::size_t CACHE_LINE = 64; // Keeps the two indices in their own cache lines
+
+		std::vector<T> items;
+		alignas(CACHE_LINE) std::atomic<std::size_t> head;	// Next item to pop, written by the consumer
+		alignas(CACHE_LINE) std::atomic<std::size_t> tail;	// Next slot to push, written by the producer
+};
+
+/**
+ * @brief FrameQueue class constructor
+ *
+ * @param depth largest number of queued items, at least one
+ */
+template <typename T>
+FrameQueue<T>::FrameQueue(std::size_t depth): items(depth + 1), head(0), tail(0) {}
+
+/**
+ * @brief Queues an item, waiting while the queue is full. Only called by the producer thread
+ *
+ * @param item item to queue
+ */
+template <typename T>
+void FrameQueue<T>::Push(const T &item) {
+	const std::size_t current = tail.load(std::memory_order_relaxed);
+	const std::size_t next = (current + 1) % items.size();
+	for (std::size_t observed; next == (observed = head.load(std::memory_order_acquire));) head.wait(observed, std::memory_order_acquire);
+	items[current] = item;
+	tail.store(next, std::memory_order_release);
+	tail.notify_one();
+}
+
+/**
+ * @brief Takes the oldest item, waiting while the queue is empty. Only called by the consumer thread
+ *
+ * @return T oldest item
+ */
+template <typename T>
+T FrameQueue<T>::Pop() {
+	const std::size_t current = head.load(std::memory_order_relaxed);
+	for (std::size_t observed; current == (observed = tail.load(std::memory_order_acquire));) tail.wait(observed, std::memory_order_acquire);
+	T item = items[current];
+	head.store((current + 1) % items.size(), std::memory_order_release);
+	head.notify_one();
+	return item;
+}
+
+#endif /* FRAME_QUEUE_HPP_ */
@@ -0,0 +1,68 @@
+/**
+ * @file FrameWorkspace.hpp
+ * @author Isaac Fonseca (isaac.fonsecasegura@ucr.ac.cr)
+ * @date 2026-10-16
+ *
+ */
+
+#ifndef FRAME_WORKSPACE_HPP_
+#define FRAME_WORKSPACE_HPP_
+
+#include <map>
+#include <tuple>
+#include <mutex>
+#include <atomic>
+#include "opencv2/core/core.hpp"
+#include "LabImage.hpp"
+
+using namespace cv;
+
+/**
+ * @brief Thread safe pool of the intermediate images of the frame pipeline. A buffer is identified by the stage
+ * that uses it, an index within the stage and its size and type, so the frame size and the filter parameters select
+ * their own set of buffers. Once a frame of a given size and configuration has been processed the following ones
+ * reuse every buffer without allocating. The buffers are shared with the callers and overwritten by the next
+ * frame, so a workspace serves one frame at a time
+ *
+ */
+class FrameWorkspace {
+	public:
+		enum Buffer : int {
+			FRAME_INPUT,		// CIELab input frame
+			USM_IMAGE,			// Deceived input of the filters
+			PADDED_WEIGHTING,	// Zero padded weighting image of the NLM filter
+			PADDED_INPUT,		// Zero padded input image of the integral NLM engine
+			PATCH_MOMENTS,		// Patch moments of the NLM pre-selection
+			SCALED_IMAGE,		// Low pass weighting image of the scaled bilateral filter
+			BAND_ACCUMULATORS,	// Row band accumulators of the symmetric bilateral filter
+			ENGINE_SCRATCH,		// Terms, differences, samples and accumulators of the trig, integral and pca engines
+			GUIDE_PLANES,		// Guiding image planes of the guided filter
+			GUIDE_MOMENTS,		// Guide means and inverse covariances of the guided filter
+			GUIDED_PLANES,		// Input and output planes of the guided filter
+			THREAD_SCRATCH,		// Per thread rows and windows of the NLM engines and the guided filter sweeps
+			TEMPORAL_CROPS,		// Cropped USM and input images of the temporal mode
+			FILTERED_IMAGE,		// Filter output
+			OUTPUT_FRAME		// 8 bit output frame
+		};
+
+		FrameWorkspace();
+		Mat Get(Buffer buffer, Size size, int type, int index = 0);
+		static Mat Acquire(FrameWorkspace *workspace, Buffer buffer, Size size, int type, int index = 0);
+		static void AcquirePlanes(FrameWorkspace *workspace, Buffer buffer, const Mat &image, Mat planes[]);
+		static Mat AcquireThread(FrameWorkspace *workspace, Buffer buffer, Size size, int type, int index = 0);
+		static LabImage AcquireLab(FrameWorkspace *workspace, Buffer buffer, Size size, int index = 0);
+		static LabImage AcquireCrop(FrameWorkspace *workspace, Buffer buffer, Size size, Size capacity, int index = 0);
+		unsigned long Allocations() const;
+		unsigned long Reuses() const;
+		void ResetCounters();
+		void Clear();
+
+	private:
+		typedef std::tuple<int, int, int, int, int> Key;
+
+		mutable std::mutex mutex;
+		std::map<Key, Mat> buffers;
+		std::atomic<unsigned long> allocations, reuses;
+};
+
+#endif /* FRAME_WORKSPACE_HPP_ */
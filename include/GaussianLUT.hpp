@@ -0,0 +1,55 @@
+/**
+ * @file GaussianLUT.hpp
+ * @author Isaac Fonseca (isaac.fonsecasegura@ucr.ac.cr)
+ * @date 2026-10-16
+ *
+ */
+
+#ifndef GAUSSIAN_LUT_HPP_
+#define GAUSSIAN_LUT_HPP_
+
+#include <vector>
+#include <cstddef>
+#include <algorithm>
+
+/**
+ * @brief Quantized lookup table for the range kernels of the WAFs. It tabulates the decreasing exponential
+ * \f[ w(d) = \exp\left( \alpha (d - \beta) \right), \quad \alpha < 0 \f]
+ * of a squared CIELab distance \f$ d \geq 0 \f$ and evaluates it through linear interpolation. The table covers the distances
+ * whose exponent is above \f$ -16 \f$, beyond that the weight is zero (\f$ e^{-16} \approx 1.1 \cdot 10^{-7} \f$).
+ * With \f$ N \f$ intervals of \f$ \Delta \f$ exponent units the interpolation error is bounded by
+ * \f[ |\tilde{w}(d) - w(d)| \leq \frac{\Delta^2}{8} \, w(0) \f]
+ * For the bilateral range kernel (\f$ \beta = 0 \f$) and \f$ N = 4096 \f$ this is \f$ 1.9 \cdot 10^{-6} \f$ of the largest weight.
+ * The table is only rebuilt when \f$ \alpha \f$ or \f$ \beta \f$ change, so it is kept across video frames
+ */
+class GaussianLUT {
+	public:
+		static const int SIZE = 4096; // Number of table intervals
+
+		GaussianLUT();
+		bool Build(float factor, float offset);
+
+		/**
+		 * @brief Evaluates the tabulated exponential
+		 *
+		 * @param distance squared distance \f$ d \geq 0 \f$, a negative one is taken as 0 and a NaN gives 0
+		 * @return float interpolated weight
+		 */
+		inline float operator()(float distance) const {
+			float x = distance * scale;
+			if (!(x < (float) SIZE)) return 0.0f;
+			x = std::max(x, 0.0f);
+			int i = (int) x;
+			float fraction = x - (float) i;
+			return table[(std::size_t) i] + fraction * (table[(std::size_t) i + 1] - table[(std::size_t) i]);
+		}
+
+		const float *Table() const;
+		float Scale() const;
+
+	private:
+		std::vector<float> table;
+		float factor, offset, scale;
+};
+
+#endif /* GAUSSIAN_LUT_HPP_ */
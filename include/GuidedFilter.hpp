@@ -14,20 +14,25 @@
 
 #include <opencv2/opencv.hpp>
 #include "opencv2/core/core.hpp"
+#include "FrameWorkspace.hpp"
 
 class GuidedFilterImpl;
 
 class GuidedFilter {
 public:
-	GuidedFilter(const cv::Mat &I, int r, double eps);
+	GuidedFilter(const cv::Mat &I, int r, double eps, int s = 1, FrameWorkspace *workspace = nullptr);
+	GuidedFilter(const cv::Mat I[3], int r, double eps, int s = 1, FrameWorkspace *workspace = nullptr);
 	~GuidedFilter();
 
 	cv::Mat filter(const cv::Mat &p, int depth = -1) const;
+	void filter(const cv::Mat p[], int channels, cv::Mat q[]) const;
 
 private:
 	GuidedFilterImpl *impl_;
 };
 
-cv::Mat guidedFilter(const cv::Mat &I, const cv::Mat &p, int r, double eps, int depth = -1);
+cv::Mat guidedFilter(const cv::Mat &I, const cv::Mat &p, int r, double eps, int depth = -1, FrameWorkspace *workspace = nullptr);
+cv::Mat fastGuidedFilter(const cv::Mat &I, const cv::Mat &p, int r, double eps, int s, int depth = -1, FrameWorkspace *workspace = nullptr);
+void guidedFilter(const cv::Mat I[3], const cv::Mat p[3], cv::Mat q[3], int r, double eps, int s = 1, FrameWorkspace *workspace = nullptr);
 
 #endif /* GUIDED_FILTER_HPP_ */
\ No newline at end of file
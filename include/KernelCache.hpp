@@ -0,0 +1,47 @@
+/**
+ * @file KernelCache.hpp
+ * @author Isaac Fonseca (isaac.fonsecasegura@ucr.ac.cr)
+ * @date 2026-10-16
+ *
+ */
+
+#ifndef KERNEL_CACHE_HPP_
+#define KERNEL_CACHE_HPP_
+
+#include <map>
+#include <tuple>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include "opencv2/core/core.hpp"
+
+using namespace cv;
+
+/**
+ * @brief Thread safe cache of the filter kernels. The kernels only depend on their kind, the window size and
+ * a standard deviation, so across the frames of a video they are built once and then shared. The cached
+ * kernels are handed out as const references to the cache entries, which stay valid until Clear(): a caller
+ * that needs to modify a kernel has to clone it, since writing to the shared data would change the kernel of
+ * every later frame
+ *
+ */
+class KernelCache {
+	public:
+		enum Kind : int {SPATIAL_GAUSSIAN, GAUSSIAN, GAUSSIAN_ROW, LOG}; // Cached kernel kinds
+
+		KernelCache();
+		const Mat &Get(Kind kind, int windowSize, double sigma, const std::function<Mat()> &build);
+		unsigned long Hits() const;
+		unsigned long Misses() const;
+		void ResetCounters();
+		void Clear();
+
+	private:
+		typedef std::tuple<int, int, double> Key;
+
+		mutable std::mutex mutex;
+		std::map<Key, Mat> kernels;
+		std::atomic<unsigned long> hits, misses;
+};
+
+#endif /* KERNEL_CACHE_HPP_ */
@@ -0,0 +1,78 @@
+/**
+ * @file Kernels.hpp
+ * @author Isaac Fonseca (isaac.fonsecasegura@ucr.ac.cr)
+ * @date 2026-10-16
+ *
+ */
+
+#ifndef KERNELS_HPP_
+#define KERNELS_HPP_
+
+#include <string>
+#include <cstddef>
+#include "GaussianLUT.hpp"
+
+/**
+ * @brief Arguments for the bilateral filter row kernels. The weighting and input images are given as
+ * CIELab planes of the image size, the window of the output pixel \f$ (i, j) \f$ is centered at the plane
+ * coordinates \f$ (i, j) \f$. Pixels outside of the planes are zero (constant border)
+ *
+ */
+struct BilateralArgs {
+	const float *weighting[3];	/// Weighting image planes
+	const float *input[3];		/// Input image planes
+	std::size_t step;			/// Row step of the planes in floats
+	int rows, cols;				/// Size of the planes
+	float *output[3];			/// First element of each output channel
+	std::size_t outputStep;		/// Row step of the output in floats
+	int outputStride;			/// Distance in floats between two consecutive output pixels
+	const float *spatialKernel;	/// Continuous windowSize x windowSize spatial Gaussian kernel
+	int windowSize;				/// Processing window size
+	float rangeFactor;			/// Range kernel exponent factor \f$ -1 / (2 \sigma_r^2) \f$
+	const GaussianLUT *rangeLUT;	/// Range kernel lookup table, the exponential is evaluated if it is null
+};
+
+/**
+ * @brief Arguments for the non local means weighting kernels. The input image is given as CIELab planes of the
+ * image size, the window of the output pixel \f$ (i, j) \f$ is centered at the plane coordinates \f$ (i, j) \f$.
+ * Pixels outside of the planes are zero (constant border)
+ *
+ */
+struct NonLocalMeansArgs {
+	const float *input[3];		/// Input image planes
+	std::size_t step;			/// Row step of the planes in floats
+	int rows, cols;				/// Size of the planes
+	int windowSize;				/// Processing window size
+	float weightFactor;			/// Weight exponent factor \f$ -1 / (2 h^2) \f$
+	float weightOffset;			/// Distance offset \f$ 2 \sigma_r^2 \f$
+	const GaussianLUT *weightLUT;	/// Weight lookup table, the exponential is evaluated if it is null
+};
+
+/**
+ * @brief Hand vectorized inner kernels for the WAFs. The instruction set is detected at startup through CPUID
+ * and can be overridden, so a single binary runs on every x86-64 generation. The kernels are also instantiated
+ * for every odd window size from MIN_SPECIALIZED_WINDOW to MAX_SPECIALIZED_WINDOW, other sizes use a generic kernel
+ *
+ */
+class Kernels {
+	public:
+		enum ISA : int {SCALAR, SSE4, AVX2, AVX512}; // Supported instruction sets
+		static const int MIN_SPECIALIZED_WINDOW = 3;	// Smallest window size with a compile time kernel
+		static const int MAX_SPECIALIZED_WINDOW = 31;	// Largest window size with a compile time kernel
+
+		static ISA DetectISA();
+		static ISA ActiveISA();
+		static bool SetISA(ISA isa);
+		static bool ParseISA(const std::string &name, ISA &isa);
+		static std::string ISAName(ISA isa);
+
+		static void BilateralRow(const BilateralArgs &args, int row, int colBegin, int colEnd);
+		static void SymmetricBilateralRow(const BilateralArgs &args, int row, float *const sums[4], std::size_t sumStep);
+		static void NonLocalMeansPixel(const NonLocalMeansArgs &args, const float *distances, int row, int col, float *output);
+		static void PatchDistances(const float *const window[3], std::size_t step, int windowSize, int neighborhoodSize, const unsigned char *candidates, float *distances);
+
+	private:
+		static ISA activeISA;
+};
+
+#endif /* KERNELS_HPP_ */
@@ -0,0 +1,43 @@
+/**
+ * @file LabConverter.hpp
+ * @author Isaac Fonseca (isaac.fonsecasegura@ucr.ac.cr)
+ * @date 2026-10-16
+ *
+ */
+
+#ifndef LAB_CONVERTER_HPP_
+#define LAB_CONVERTER_HPP_
+
+#include <cstddef>
+#include "opencv2/core/core.hpp"
+
+using namespace cv;
+
+/**
+ * @brief Fused conversions between 8 bit BGR frames and float CIELab images, each one in a single parallel pass.
+ * They follow the sRGB (D65) conversion of OpenCV for normalized float images, without the intermediate float BGR
+ * image. Since the inputs are 8 bit, the sRGB linearization and the XYZ matrix are folded into one table per
+ * channel and XYZ component, so a pixel costs nine lookups and three sums. The Lab nonlinearity and the sRGB gamma
+ * are evaluated through linearly interpolated tables of SIZE intervals. Over every 8 bit color the Lab values stay
+ * within \f$ 2.1 \cdot 10^{-3} \f$ of the exact conversion (the tables of cvtColor are within 0.47), and the 8 bit
+ * BGR output of a Lab image matches cvtColor. The Lab images can be interleaved or planar
+ *
+ */
+class LabConverter {
+	public:
+		static const int SIZE = 4096; // Intervals of the interpolated tables
+
+		static void BGRToLab(const Mat &bgr, Mat &lab);
+		static void BGRToLab(const Mat &bgr, Mat planes[3]);
+		static void LabToBGR(const Mat &lab, Mat &bgr);
+		static void LabToBGR(const Mat planes[3], Mat &bgr);
+
+	private:
+		struct Tables;
+		static const Tables &GetTables();
+
+		static void BGRToLabRow(const Tables &tables, const uchar *bgr, int channels, int cols, float *const lab[3], int stride);
+		static void LabToBGRRow(const Tables &tables, const float *const lab[3], int stride, int cols, uchar *bgr);
+};
+
+#endif /* LAB_CONVERTER_HPP_ */
@@ -0,0 +1,42 @@
+/**
+ * @file LabImage.hpp
+ * @author Isaac Fonseca (isaac.fonsecasegura@ucr.ac.cr)
+ * @date 2026-10-16
+ *
+ */
+
+#ifndef LAB_IMAGE_HPP_
+#define LAB_IMAGE_HPP_
+
+#include <cstddef>
+#include "opencv2/core/core.hpp"
+
+using namespace cv;
+
+/**
+ * @brief Planar CIELab image, the internal image layout of the framework. The L, a and b channels live in three
+ * float planes, so the channel loops of the filters and kernels read contiguous rows without splitting the image.
+ * Each plane is a view of its own buffer, whose rows are padded to a multiple of ALIGNMENT bytes: every plane row
+ * starts aligned for the vector kernels and the three planes share the same step. The padding columns are kept at
+ * zero, so an OpenCV filter with a constant border that reads past the right edge of a plane sees the same zeros.
+ * Each plane also starts a buffer of its own, so the rows above and below a plane are never read as image data
+ *
+ */
+class LabImage {
+	public:
+		static const int ALIGNMENT = 64; // Row alignment in bytes, a cache line and an AVX-512 register
+		Mat planes[3]; /// CV_32FC1 L, a and b planes
+
+		LabImage();
+		LabImage(Size size);
+		LabImage(const Mat buffers[3], Size size);
+		static int PaddedCols(int cols);
+		Size ImageSize() const;
+		std::size_t Step() const;
+		bool Empty() const;
+		LabImage Crop(const Rect &region) const;
+		LabImage Clone() const;
+		void CopyTo(LabImage &destination) const;
+};
+
+#endif /* LAB_IMAGE_HPP_ */
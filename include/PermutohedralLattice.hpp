@@ -0,0 +1,66 @@
+/**
+ * @file PermutohedralLattice.hpp
+ * @author Isaac Fonseca (isaac.fonsecasegura@ucr.ac.cr)
+ * @date 2026-10-16
+ *
+ */
+
+#ifndef PERMUTOHEDRAL_LATTICE_HPP_
+#define PERMUTOHEDRAL_LATTICE_HPP_
+
+#include <vector>
+#include <cstddef>
+
+/**
+ * @brief Sparse permutohedral lattice for high dimensional Gaussian filtering, after
+ * A. Adams, J. Baek and M. A. Davis, "Fast High-Dimensional Filtering Using the Permutohedral Lattice", 2010.
+ * Values are splatted on the vertices of the simplex enclosing their position, blurred along the
+ * lattice directions and sliced back at the same positions. The positions have to be scaled so the
+ * desired Gaussian has a unit standard deviation, the cost is then linear in the number of pixels and
+ * independent of the Gaussian extent.
+ * The resolution \f$ s \in (0, 1] \f$ sets the lattice points per standard deviation. The full resolution is the
+ * original lattice, lower ones shrink the lattice and its blur for speed, at the cost of a larger error.
+ * Finer lattices are not offered: the lattice only holds the splatted simplices, so the blur can not diffuse
+ * through the empty points in between.
+ * Reset empties the lattice for a new image but keeps its tables, so a lattice reused from one frame to the next
+ * only allocates while its frames grow
+ */
+class PermutohedralLattice {
+	public:
+		static const int D = 5;		// Position dimensions: x, y, L, a, b
+		static const int VD = 4;	// Value dimensions: L, a, b and the homogeneous weight
+
+		PermutohedralLattice();
+		PermutohedralLattice(std::size_t pixels, float resolution);
+
+		void Reset(std::size_t pixels, float resolution);
+
+		void Splat(const float *position, const float *value);
+		void Blur();
+		void Slice(const float *position, float *value) const;
+
+		std::size_t Points() const;
+
+	private:
+		float resolution;
+		float scaleFactor[D];
+		int canonical[(D + 1) * (D + 1)];
+
+		// Open addressing hash table from the lattice keys to the lattice points
+		std::vector<int> keys;		// D coordinates per lattice point, the last one is implied
+		std::vector<float> values;	// VD values per lattice point
+		std::vector<int> slots;		// Lattice point index per slot, -1 if empty
+		std::size_t points;
+
+		// Scratch of the blur
+		std::vector<int> neighbors;	// Previous and next lattice points along every direction, -1 if missing
+		std::vector<float> blurred;	// Values blurred along the current direction
+
+		void Embed(const float *position, int *vertexKeys, float *barycentric) const;
+		int Find(const int *key) const;
+		int Insert(const int *key);
+		void Grow();
+		std::size_t Hash(const int *key) const;
+};
+
+#endif /* PERMUTOHEDRAL_LATTICE_HPP_ */
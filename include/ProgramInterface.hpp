@@ -11,14 +11,21 @@
 #define PROGRAM_INTERFACE_HPP_
 
 #include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
 #include <cstdio>
 #include <iomanip>
+#include <thread>
 #include <unistd.h>
 #include <iostream>
 #include <getopt.h>
 #include "Utils.hpp"
 #include "Timer.hpp"
 #include "DeWAFF.hpp"
+#include "FrameQueue.hpp"
+#include "LabConverter.hpp"
+#include "CountingAllocator.hpp"
 
 /**
  * @brief In charge of displaying the program and capturing the needed parameters
@@ -45,10 +52,17 @@ private:
 	Size frameSize;
 	int codec, frameCount, frameRate;
 	std::string codecType;
+	int pipelineDepth;
+	int framesInFlight;
+	static const int AUTO_FRAMES = 0; // Split the cores between frames and threads per frame from the frame size
+	static const long MIN_PIXELS_PER_THREAD = 1 << 16; // Smallest share of a frame worth an extra thread
 
 	// Framework configuration
+	FrameWorkspace workspace;
+	unsigned long lastFrameMisses; // Workspace misses of the last frame
+	unsigned long lastFrameMats; // Mat buffers allocated by the last frame, measured by the counting allocator
+	TemporalTiles temporalTiles;
 	DeWAFF framework;
-	Utils utilsLib;
 	Timer timer;
 	int windowSize, neighborhoodSize;
 	double rangeSigma, spatialSigma;
@@ -60,10 +74,35 @@ private:
 		DGF
 	};
 
+	// Frame in flight through the video pipeline, with its own buffers for the color conversions
+	struct PipelineFrame {
+		Mat frame, output;
+		LabImage input, filtered;
+		FrameWorkspace workspace;
+	};
+
+	// Frame parallel worker, with its own framework copy and buffers
+	struct FrameWorker {
+		DeWAFF framework;
+		FrameWorkspace workspace;
+	};
+	std::vector<std::unique_ptr<FrameWorker>> frameWorkers;
+
+	// Reorder buffer slot of the frame parallel mode, tagged with the sequence number of the frame it holds
+	struct ReorderSlot {
+		Mat frame, output;
+		unsigned long misses = 0, mats = 0;
+		std::atomic<long> decoded{-1}, filtered{-1};
+	};
+
 	// Input processing
-	Mat inputPreProcessor(const Mat &inputImage);
-	Mat outputPosProcessor(const Mat &inputImage);
+	LabImage inputPreProcessor(const Mat &inputImage, FrameWorkspace &frameWorkspace);
+	Mat outputPosProcessor(const LabImage &inputImage, FrameWorkspace &frameWorkspace);
+	LabImage filterFrame(DeWAFF &filterFramework, const LabImage &input);
 	Mat processFrame(const Mat &frame);
+	void processPipeline(VideoCapture &inputVideo, VideoWriter *outputVideo);
+	void processFrameParallel(VideoCapture &inputVideo, VideoWriter *outputVideo, int frames, int threads);
+	void frameSplit(int &frames, int &threads);
 	void processImage();
 	void processVideo();
 	void benchmarkImage();
@@ -76,6 +115,7 @@ private:
 	void displayImageInfo();
 	void displayBenchmarkHeader();
 	void displayBenchmarkFooter();
+	void displayApproximationError(const Mat &inputFrame);
 	void setOutputFileName();
 	void errorMessage(std::string msg);
 	void longHelp();
@@ -86,8 +126,8 @@ private:
 
 	// Output spacing
 	enum spacing {
-		MAIN_LINE = 29,
-		DATA_SPACE = 11,
+		MAIN_LINE = 33,
+		DATA_SPACE = 15,
 		VALUE_SPACE = 10,
 		BENCHMARK_LINE = 20,
 		NUMBER_SPACE = 3,
@@ -0,0 +1,44 @@
+/**
+ * @file TemporalTiles.hpp
+ * @author Isaac Fonseca (isaac.fonsecasegura@ucr.ac.cr)
+ * @date 2026-10-16
+ *
+ */
+
+#ifndef TEMPORAL_TILES_HPP_
+#define TEMPORAL_TILES_HPP_
+
+#include <vector>
+#include "opencv2/core/core.hpp"
+#include "opencv2/imgproc/imgproc.hpp"
+
+using namespace cv;
+
+/**
+ * @brief Tracks the tiles of a video that changed since they were last filtered. Each incoming frame is compared
+ * tile wise against a reference frame, a tile changed if any of its values moved by more than the tolerance. Only
+ * the changed tiles are copied into the reference, so slow drifts under the tolerance still add up to a change.
+ * The regions to refilter are the changed tiles grown by the reach of the filter, the rest of the output can be
+ * reused from the previous frame
+ *
+ */
+class TemporalTiles {
+	public:
+		static const int TILE_SIZE = 32; // Side of the compared tiles
+
+		TemporalTiles();
+		double tolerance; /// Largest absolute difference of an unchanged 8 bit value
+
+		void Update(const Mat &frame);
+		std::vector<Rect> DirtyRegions(int radius, bool all);
+		void Reset();
+		double SkippedFraction() const;
+		void ResetCounters();
+
+	private:
+		Mat reference;	// Input of the tiles when they were last filtered
+		Mat changed;	// One byte per tile, non zero if the tile changed in the last frame
+		unsigned long skippedTiles, totalTiles;
+};
+
+#endif /* TEMPORAL_TILES_HPP_ */
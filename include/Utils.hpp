@@ -12,9 +12,14 @@
 
 #include <iostream>
 #include <algorithm>
+#include <cfloat>
 #include "opencv2/core/core.hpp"
 #include "opencv2/imgproc/imgproc.hpp"
 #include "opencv2/highgui/highgui.hpp"
+#include "Kernels.hpp"
+#include "KernelCache.hpp"
+#include "FrameWorkspace.hpp"
+#include "LabImage.hpp"
 
 using namespace cv;
 
@@ -24,13 +29,20 @@ using namespace cv;
  */
 class Utils {
 	public:
+		static KernelCache kernelCache; /// Kernels shared by all the Utils instances
+		FrameWorkspace *workspace; /// Buffers reused across frames, null allocates them on every call
+		float usmScale; /// Laplacian scale of the last USM image, it depends on the whole image
+
+		Utils();
 		void MeshGrid(const Range &range, Mat &X, Mat &Y);
-		void MinMax(const Mat& A, double* minA, double* maxA);
 		Mat GaussianFunction(Mat input, double sigma);
-		Mat GaussianKernel(int windowSize, double sigma);
+		const Mat &SpatialGaussianKernel(int windowSize, double sigma);
+		const Mat &GaussianKernel(int windowSize, double sigma);
+		const Mat &GaussianRowKernel(int windowSize, double sigma);
+		const Mat &LoGKernel(int windowSize, double sigma);
 		Mat LoGFilter(const Mat &image, int windowSize, double sigma);
-		Mat NonAdaptiveUSMFilter(const Mat &image, int windowSize, double lambda, double sigma);
-		Mat EuclideanDistancesMatrix(const Mat& image, int windowSize, int neighborhoodSize);
+		LabImage NonAdaptiveUSMFilter(const LabImage &image, int windowSize, double lambda, double sigma);
+		void EuclideanDistancesMatrix(const Mat planes[3], int row, int col, int windowSize, int neighborhoodSize, const unsigned char *candidates, Mat &distances);
 };
 
 #endif /* UTILS_HPP_ */
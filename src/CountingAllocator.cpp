@@ -0,0 +1,52 @@
+#include "CountingAllocator.hpp"
+
+std::atomic<unsigned long> CountingAllocator::allocations(0);
+
+/**
+ * @brief CountingAllocator class constructor
+ *
+ * @param wrapped allocator that owns the buffers
+ */
+CountingAllocator::CountingAllocator(MatAllocator *wrapped): wrapped(wrapped) {}
+
+/**
+ * @brief Installs the counting allocator as the default Mat allocator, wrapping the current default. Only the
+ * first call installs it, the matrices allocated before keep their allocator
+ *
+ */
+void CountingAllocator::Install() {
+	static CountingAllocator instance(Mat::getDefaultAllocator());
+	if (Mat::getDefaultAllocator() != &instance) Mat::setDefaultAllocator(&instance);
+}
+
+/**
+ * @brief Gets the number of Mat buffers allocated since the allocator was installed
+ *
+ * @return unsigned long allocated buffers
+ */
+unsigned long CountingAllocator::Allocations() {
+	return allocations.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Allocates a matrix buffer through the wrapped allocator, counting it unless the data is user provided.
+ * The buffer belongs to the wrapped allocator, which also releases it
+ */
+UMatData *CountingAllocator::allocate(int dims, const int *sizes, int type, void *data, size_t *step, AccessFlag flags, UMatUsageFlags usageFlags) const {
+	if (!data) allocations.fetch_add(1, std::memory_order_relaxed);
+	return wrapped->allocate(dims, sizes, type, data, step, flags, usageFlags);
+}
+
+/**
+ * @brief Forwards the allocation of an existing buffer descriptor to the wrapped allocator
+ */
+bool CountingAllocator::allocate(UMatData *data, AccessFlag accessFlags, UMatUsageFlags usageFlags) const {
+	return wrapped->allocate(data, accessFlags, usageFlags);
+}
+
+/**
+ * @brief Forwards the release of a buffer to the wrapped allocator
+ */
+void CountingAllocator::deallocate(UMatData *data) const {
+	wrapped->deallocate(data);
+}
@@ -4,7 +4,67 @@
  * @brief DeWAFF class constructor. Sets the lambda parameter for the Laplacian deceive
  *
  */
-DeWAFF::DeWAFF(): usmLambda(1.0){}
+DeWAFF::DeWAFF(): temporalScale(0.0f), usmLambda(1.0), temporalTiles(nullptr) {}
+
+/**
+ * @brief Sets the workspace whose buffers are reused by the USM stage and the filters from one frame to the next
+ *
+ * @param workspace frame workspace, null allocates the images on every call
+ */
+void DeWAFF::SetWorkspace(FrameWorkspace *workspace) {
+	utilsLib.workspace = workspace;
+	filtersLib.workspace = workspace;
+}
+
+/**
+ * @brief Applies a filter to the regions of the frame that changed and reuses the previous output elsewhere.
+ * The USM image is always computed whole, since its Laplacian scale depends on the whole frame, and a frame whose
+ * scale moved beyond the tile tolerance is filtered whole. Otherwise each dirty region is filtered on a crop grown
+ * by the halo of the filter, so the crop borders do not reach the region, and is copied into the previous output.
+ * The crops are copied into workspace buffers of the frame size. The buffers of the filters depend on the crop
+ * sizes, which change from frame to frame, so the filters allocate them on every crop.
+ * The grid, trig and pca engines adapt to the whole image they are given, its lattice, dynamic range or patch
+ * basis, so a crop would not match the frame and they are not accepted here
+ *
+ * @param usmImage USM image of the whole frame
+ * @param inputImage input image of the whole frame
+ * @param usmRadius radius of the USM Laplacian
+ * @param halo radius of the input read by the filter for an output pixel
+ * @param filter filter applied to the USM and input images
+ * @return LabImage filtered frame
+ */
+LabImage DeWAFF::TemporalFilter(const LabImage &usmImage, const LabImage &inputImage, int usmRadius, int halo, const std::function<LabImage(const LabImage&, const LabImage&)> &filter) {
+	if (!temporalTiles) return filter(usmImage, inputImage);
+	CV_Assert(filtersLib.engine != Filters::GRID && filtersLib.engine != Filters::TRIG && filtersLib.engine != Filters::PCA);
+
+	const Size size = inputImage.ImageSize();
+	const bool rescaled = std::abs(utilsLib.usmScale - temporalScale) > (float) (temporalTiles->tolerance / 255.0) * std::abs(temporalScale);
+	const bool fresh = rescaled || temporalOutput.Empty() || temporalOutput.ImageSize() != size;
+	std::vector<Rect> regions = temporalTiles->DirtyRegions(usmRadius + halo, fresh);
+	if (fresh || (regions.size() == 1 && regions[0].size() == size)) {
+		filter(usmImage, inputImage).CopyTo(temporalOutput);
+		temporalScale = utilsLib.usmScale;
+		return temporalOutput;
+	}
+
+	// The crops are copied, so the filters do not read the neighbouring image values as their border
+	FrameWorkspace *workspace = filtersLib.workspace;
+	filtersLib.workspace = nullptr;
+	const Rect frame(0, 0, size.width, size.height);
+	for (const Rect &region : regions) {
+		const Rect crop = Rect(region.x - halo, region.y - halo, region.width + 2 * halo, region.height + 2 * halo) & frame;
+		LabImage usmCrop = FrameWorkspace::AcquireCrop(workspace, FrameWorkspace::TEMPORAL_CROPS, crop.size(), size, 0);
+		LabImage inputCrop = FrameWorkspace::AcquireCrop(workspace, FrameWorkspace::TEMPORAL_CROPS, crop.size(), size, 1);
+		usmImage.Crop(crop).CopyTo(usmCrop);
+		inputImage.Crop(crop).CopyTo(inputCrop);
+		LabImage filtered = filter(usmCrop, inputCrop);
+		LabImage target = temporalOutput.Crop(region);
+		filtered.Crop(region - crop.tl()).CopyTo(target);
+	}
+	filtersLib.workspace = workspace;
+
+	return temporalOutput;
+}
 
 /**
  * @brief Apply a Deceived Bilateral Filter to an image.
@@ -19,11 +79,13 @@ DeWAFF::DeWAFF(): usmLambda(1.0){}
  * where
  * \f[ \hat{f}_{\text USM} = U + \lambda \, \text{LoG} \f]
  */
-Mat DeWAFF::DeceivedBilateralFilter(const Mat &inputImage, int windowSize, double spatialSigma, double rangeSigma) {
+LabImage DeWAFF::DeceivedBilateralFilter(const LabImage &inputImage, int windowSize, double spatialSigma, double rangeSigma) {
 	// Pre process the USM image
-	Mat usmImage = utilsLib.NonAdaptiveUSMFilter(inputImage, windowSize, usmLambda, spatialSigma);
+	LabImage usmImage = utilsLib.NonAdaptiveUSMFilter(inputImage, windowSize, usmLambda, spatialSigma);
 	// Calculate the deceived filter
-	return filtersLib.BilateralFilter(usmImage, inputImage, windowSize, spatialSigma, rangeSigma);
+	return TemporalFilter(usmImage, inputImage, windowSize / 2, windowSize / 2, [&](const LabImage &usm, const LabImage &input) {
+		return filtersLib.BilateralFilter(usm, input, windowSize, spatialSigma, rangeSigma);
+	});
 }
 
 /**
@@ -40,11 +102,13 @@ Mat DeWAFF::DeceivedBilateralFilter(const Mat &inputImage, int windowSize, doubl
  * where
  * \f[ \hat{f}_{\text USM} = U + \lambda \, \text{LoG} \f]
  */
-Mat DeWAFF::DeceivedScaledBilateralFilter(const Mat &inputImage, int windowSize, double spatialSigma, double rangeSigma) {
+LabImage DeWAFF::DeceivedScaledBilateralFilter(const LabImage &inputImage, int windowSize, double spatialSigma, double rangeSigma) {
 	// Pre process the USM image
-	Mat usmImage = utilsLib.NonAdaptiveUSMFilter(inputImage, windowSize, usmLambda, spatialSigma);
-	// Calculate the deceived filter
-	return filtersLib.ScaledBilateralFilter(usmImage, inputImage, windowSize, spatialSigma, rangeSigma);
+	LabImage usmImage = utilsLib.NonAdaptiveUSMFilter(inputImage, windowSize, usmLambda, spatialSigma);
+	// Calculate the deceived filter, the low pass filter of the weighting image doubles its halo
+	return TemporalFilter(usmImage, inputImage, windowSize / 2, 2 * (windowSize / 2), [&](const LabImage &usm, const LabImage &input) {
+		return filtersLib.ScaledBilateralFilter(usm, input, windowSize, spatialSigma, rangeSigma);
+	});
 }
 
 /**
@@ -63,11 +127,18 @@ Mat DeWAFF::DeceivedScaledBilateralFilter(const Mat &inputImage, int windowSize,
  * where
  * \f[ \hat{f}_{\text USM} = U + \lambda \, \text{LoG} \f]
  */
-Mat DeWAFF::DeceivedNonLocalMeansFilter(const Mat &inputImage, int windowSize, int neighborhoodSize, double spatialSigma, double rangeSigma) {
+LabImage DeWAFF::DeceivedNonLocalMeansFilter(const LabImage &inputImage, int windowSize, int neighborhoodSize, double spatialSigma, double rangeSigma) {
 	// Pre process the USM image
-	Mat usmImage = utilsLib.NonAdaptiveUSMFilter(inputImage, windowSize, usmLambda, spatialSigma);
-	// Calculate the deceived filter
-	return filtersLib.NonLocalMeansFilter(usmImage, inputImage, windowSize, neighborhoodSize, rangeSigma);
+	LabImage usmImage = utilsLib.NonAdaptiveUSMFilter(inputImage, windowSize, usmLambda, spatialSigma);
+	// Calculate the deceived filter. The exact engine replicates the window border for the patches, the other
+	// engines and the pre-selection moments read the whole patch of every window pixel, and the symmetric
+	// integral engine also weights the pixels windowSize / 2 pixels outside of the crop
+	int halo = windowSize / 2 + neighborhoodSize / 2;
+	if (filtersLib.engine != Filters::EXACT || filtersLib.pruneThreshold > 0.0)
+		halo = 2 * (windowSize / 2) + neighborhoodSize + (filtersLib.symmetric ? windowSize / 2 : 0);
+	return TemporalFilter(usmImage, inputImage, windowSize / 2, halo, [&](const LabImage &usm, const LabImage &input) {
+		return filtersLib.NonLocalMeansFilter(usm, input, windowSize, neighborhoodSize, rangeSigma);
+	});
 }
 
 /**
@@ -83,9 +154,14 @@ Mat DeWAFF::DeceivedNonLocalMeansFilter(const Mat &inputImage, int windowSize, i
  * where
  * \f[ \hat{f}_{\text USM} = U + \lambda \, \text{LoG} \f]
  */
-Mat DeWAFF::DeceivedGuidedFilter(const Mat &inputImage, int windowSize, double spatialSigma, double rangeSigma) {
+LabImage DeWAFF::DeceivedGuidedFilter(const LabImage &inputImage, int windowSize, double spatialSigma, double rangeSigma) {
 	// Pre process the USM image
-	Mat usmImage = utilsLib.NonAdaptiveUSMFilter(inputImage, windowSize, usmLambda, spatialSigma);
-	// Calculate the deceived filter
-	return filtersLib.GuidedFilter(usmImage, inputImage, windowSize, rangeSigma);
+	LabImage usmImage = utilsLib.NonAdaptiveUSMFilter(inputImage, windowSize, usmLambda, spatialSigma);
+	// Calculate the deceived filter, an output averages the coefficients of the windows around it.
+	// The subsampled mode resamples from the crop origin, so its grid would not match the frame's
+	CV_Assert(!temporalTiles || filtersLib.guidedSubsampling == 1);
+	const int halo = 2 * (windowSize / 2);
+	return TemporalFilter(usmImage, inputImage, windowSize / 2, halo, [&](const LabImage &usm, const LabImage &input) {
+		return filtersLib.GuidedFilter(usm, input, windowSize, rangeSigma);
+	});
 }
\ No newline at end of file
@@ -1,5 +1,39 @@
 #include "Filters.hpp"
 
+/**
+ * @brief Filters class constructor. The filters are evaluated exactly by default and the bilateral
+ * filters are tiled to fit the L2 cache
+ *
+ */
+Filters::Filters(): prunedCandidates(0), comparedCandidates(0), engine(EXACT), gridResolution(1.0f), trigTolerance(0.1), pcaDimensions(8), rangeLUT(false),
+	symmetric(false), pruneThreshold(0.0), tileSize(AUTO_TILE), guidedSubsampling(1), workspace(nullptr) {}
+
+/**
+ * @brief Gets the tile side used by the bilateral filters. With AUTO_TILE the tile is the largest one whose
+ * weighting and input regions with their halo plus its output fit in half of the L2 cache, leaving the other half to the
+ * spatial kernel and the neighbouring tiles. The side is rounded down to a multiple of the widest vector (16 pixels)
+ *
+ * @param windowSize processing window size
+ * @return int tile side in pixels, 0 if tiling is disabled
+ */
+int Filters::TileSize(int windowSize) const {
+	if (tileSize != AUTO_TILE) return tileSize;
+
+	long cacheSize = sysconf(_SC_LEVEL2_CACHE_SIZE);
+	if (cacheSize <= 0) cacheSize = 256 * 1024; // Conservative L2 size when it can not be detected
+
+	// Six planes with a halo are read and three output channels are written per tile
+	const long vectorWidth = 16;
+	auto workingSet = [windowSize](long side) {
+		long paddedSide = side + windowSize - 1;
+		return (6 * paddedSide * paddedSide + 3 * side * side) * (long) sizeof(float);
+	};
+	long side = vectorWidth;
+	while (workingSet(side + vectorWidth) <= cacheSize / 2) side += vectorWidth;
+
+	return (int) side;
+}
+
 /**
  * @brief Apply a Bilateral Filter to an image. This is the decoupled version of this filter, this means
  * that the weighting image for the filter can be different from its input image.
@@ -11,107 +45,373 @@
  * @param rangeSigma range or radiometric standard deviation
  * @return Mat output image
  */
-Mat Filters::BilateralFilter(const Mat &inputImage_, const Mat &weightingImage_, int windowSize, double spatialSigma, double rangeSigma) {
-	// Set the padding value
-	int padding = (windowSize - 1) / 2;
-
-	// Working images
-	Mat inputImage, weightingImage;
-
-	// Add padding to the input for kernel consistency
-	copyMakeBorder(inputImage_, inputImage, padding, padding, padding, padding, BORDER_CONSTANT);
-	copyMakeBorder(weightingImage_, weightingImage, padding, padding, padding, padding, BORDER_CONSTANT);
-
-	// Pre compute the m - p = |m-p| factors
-	Mat X, Y;
-	Range range = Range((-windowSize / 2), (windowSize / 2) + 1);
-	utilsLib.MeshGrid(range, X, Y);
-	pow(X, 2.0, X);
-	pow(Y, 2.0, Y);
-	Mat euclideanDistances = X + Y;
+LabImage Filters::BilateralFilter(const LabImage &inputImage_, const LabImage &weightingImage_, int windowSize, double spatialSigma, double rangeSigma) {
+	// The approximate engines do not grow with the window size
+	if (engine == GRID) return LatticeBilateralFilter(inputImage_, weightingImage_, spatialSigma, rangeSigma);
+	if (engine == TRIG) return TrigonometricBilateralFilter(inputImage_, weightingImage_, windowSize, spatialSigma, rangeSigma);
 
 	/**
 	 * This filter uses two Gaussian kernels, one of them is the spatial Gaussian kernel:
 	 * \f[ G_{\text spatial}(U, m, p) = \exp\left(-\frac{ ||m - p||^2 }{ 2 {\sigma_s^2} } \right) \f]
 	 * with the spatial values from an image region \f$ \Omega \subseteq U \f$.
 	 * The spatial kernel uses the \f$ m_i \subset \Omega \f$ pixels coordinates as weighting values for the pixel \f$ p = (x, y) \f$.
+	 * It only depends on the window size and \f$ \sigma_s \f$, so it is taken from the kernel cache.
+	 */
+	const Mat &spatialGaussian = utilsLib.SpatialGaussianKernel(windowSize, spatialSigma);
+
+	/**
+	 * The other used kernel is the range Gaussian kernel:
+	 * \f[ G_{\text range}(U, m, p) = \exp\left( -\frac{ ||U(m) - U(p)||^2 }{ 2{\sigma_r^2} } \right) \f]
+	 * with the intensity (range) values from an image region \f$ \Omega \subseteq U \f$.
+	 * The range kernel uses the \f$ m_i \subset \Omega \f$ pixels intensities as weighting values for the pixel \f$ p = (x, y) \f$ instead of their
+	 * locations as in the spatial kernel computation. The squared distance is accumulated over the three CIELab channels of \f$ U \f$.
+	 * The Gaussian normalization constant is left out as it cancels with the filter's norm.
+	 * When rangeLUT is set the range kernel is interpolated from a GaussianLUT table instead of evaluating the exponential.
+	 */
+	const float rangeFactor = (float) (-1.0 / (2.0 * pow(rangeSigma, 2.0)));
+
+	/**
+	 * The two kernels are multiplied to obtain the Bilateral Filter kernel:
+	 * \f[ \psi_{\text BF}(U, m, p) = G_{\text spatial}(U, m, p) \, G_{\text range}(U, m, p) \f]
+	 * The Bilateral filter's norm corresponds to:
+	 * \f[ \left( \sum_{m \subset \Omega} \psi_{\text{BF}}(U, m, p) \right)^{-1} \f]
+	 * Finally the bilateral filter kernel can be convolved with the input as follows:
+	 * \f[ Y_{\psi_{\text BF}}(p) = \left( \sum_{m \subset \Omega} \psi_{\text BF}(U, m, p) \right)^{-1}
+	 * \left( \sum_{m \subset \Omega} \psi_{\text BF}(U, p, m) \, U(m) \right) \f]
+	 * The kernel reads the CIELab planes of both images in place and writes the output planes, so consecutive output
+	 * pixels are evaluated at once with the instruction set selected by the Kernels class. The pixels outside of the
+	 * image are taken as zeros by the kernels themselves, so the planes are not padded.
+	 * The output is split in square tiles that are each processed by one thread. A tile only reads its own
+	 * region of the planes plus a halo of windowSize / 2 pixels, which stays in cache for the whole tile
 	 */
-	Mat spatialGaussian = utilsLib.GaussianFunction(euclideanDistances, spatialSigma);
-
-	// Prepare variables for the bilateral filtering
-	Mat outputImage(inputImage.size(), inputImage.type());
-	Mat weightingRegion, inputRegion;
-	Mat dL, da, db, bilateralFilter, rangeGaussian;
-	double bilateralFilterNorm;
-	int iMin, iMax, jMin, jMax;
-	Range xRange, yRange;
-	Vec3f pixel;
-	Mat weightingChannels[3], inputChannels[3];
+	CV_Assert(inputImage_.ImageSize() == weightingImage_.ImageSize() && inputImage_.Step() == weightingImage_.Step());
+
+	// Prepare the output image
+	const Size size = inputImage_.ImageSize();
+	LabImage outputImage = FrameWorkspace::AcquireLab(workspace, FrameWorkspace::FILTERED_IMAGE, size);
+
+	BilateralArgs args;
+	for (int channel = L; channel <= b; channel++) {
+		args.weighting[channel] = weightingImage_.planes[channel].ptr<float>();
+		args.input[channel] = inputImage_.planes[channel].ptr<float>();
+		args.output[channel] = outputImage.planes[channel].ptr<float>();
+	}
+	args.step = weightingImage_.Step();
+	args.rows = size.height;
+	args.cols = size.width;
+	args.outputStep = outputImage.Step();
+	args.outputStride = 1;
+	args.spatialKernel = spatialGaussian.ptr<float>();
+	args.windowSize = windowSize;
+	args.rangeFactor = rangeFactor;
+	args.rangeLUT = nullptr;
+	if (rangeLUT) {
+		rangeTable.Build(rangeFactor, 0.0f);
+		args.rangeLUT = &rangeTable;
+	}
+
+	// The symmetric mode replaces the tiles with bands of rows
+	if (symmetric) {
+		SymmetricBilateralFilter(args, outputImage);
+		return outputImage;
+	}
+
+	// Full rows are single tiles when tiling is disabled
+	int tile = TileSize(windowSize);
+	int tileRows = tile > 0 ? tile : 1;
+	int tileCols = tile > 0 ? tile : size.width;
+	int verticalTiles = (size.height + tileRows - 1) / tileRows;
+	int horizontalTiles = (size.width + tileCols - 1) / tileCols;
 
 	// Set the parallelization pragma for OpenMP
-	#pragma omp parallel for\
-	private(iMin, iMax, jMin, jMax, xRange, yRange,weightingRegion, weightingChannels, inputRegion, inputChannels,\
-	pixel, dL, da, db, rangeGaussian, bilateralFilter, bilateralFilterNorm)\
-	shared(inputImage, weightingImage, outputImage, windowSize, spatialSigma, rangeSigma)
-	for (int i = padding; i < inputImage.rows - padding; i++) {
-		iMin = i - padding;
-		iMax = iMin + windowSize;
-		xRange = Range(iMin, iMax);
-		for (int j = padding; j < inputImage.cols - padding; j++) {
-			jMin = j - padding;
-			jMax = jMin + windowSize;
-			yRange = Range(jMin, jMax);
-
-			// Extract local weightRegion based on the window size
-			weightingRegion = weightingImage(xRange, yRange);
-			cv::split(weightingRegion, weightingChannels);
-
-			/**
-			 * The other used kernel is the range Gaussian kernel:
-			 * \f[ G_{\text range}(U, m, p) = \exp\left( -\frac{ ||U(m) - U(p)||^2 }{ 2{\sigma_r^2} } \right) \f]
-			 * with the intensity (range) values from an image region \f$ \Omega \subseteq U \f$.
-			 * The range kernel uses the \f$ m_i \subset \Omega \f$ pixels intensities as weighting values for the pixel \f$ p = (x, y) \f$ instead of their
-			 * locations as in the spatial kernel computation. In this case a the input \f$ U \f$ is separated into the three CIELab weightChannels and each
-			 * channel is processed as an individual input \f$ U_{\text channel} \f$.
-			 */
-			pixel = weightingImage.at<Vec3f>(i, j);
-			cv::pow(weightingChannels[L] - pixel.val[L], 2.0, dL);
-			cv::pow(weightingChannels[a] - pixel.val[a], 2.0, da);
-			cv::pow(weightingChannels[b] - pixel.val[b], 2.0, db);
-			rangeGaussian = utilsLib.GaussianFunction(dL + da + db, rangeSigma);
-
-			/**
-			 * The two kernels are multiplied to obtain the Bilateral Filter kernel:
-			 * \f[ \psi_{\text BF}(U, m, p) = G_{\text spatial}(U, m, p) \, G_{\text range}(U, m, p) \f]
-			 *
-			 */
-
-			bilateralFilter = spatialGaussian.mul(rangeGaussian);
-
-			/**
-			 * The Bilateral filter's norm corresponds to:
-			 * \f[ \left( \sum_{m \subset \Omega} \psi_{\text{BF}}(U, m, p) \right)^{-1} \f]
-			 */
-			bilateralFilterNorm = sum(bilateralFilter).val[0];
-
-			/**
-			 * Finally the bilateral filter kernel can be convolved with the input as follows:
-			 * \f[ Y_{\psi_{\text BF}}(p) = \left( \sum_{m \subset \Omega} \psi_{\text BF}(U, m, p) \right)^{-1}
-			 * \left( \sum_{m \subset \Omega} \psi_{\text BF}(U, p, m) \, U(m) \right) \f]
-			 */
-			inputRegion = inputImage(xRange, yRange);
-			cv::split(inputRegion, inputChannels);
-			outputImage.at<Vec3f>(i, j)[L] = (1 / bilateralFilterNorm) * sum(bilateralFilter.mul(inputChannels[L])).val[0];
-			outputImage.at<Vec3f>(i, j)[a] = (1 / bilateralFilterNorm) * sum(bilateralFilter.mul(inputChannels[a])).val[0];
-			outputImage.at<Vec3f>(i, j)[b] = (1 / bilateralFilterNorm) * sum(bilateralFilter.mul(inputChannels[b])).val[0];
+	#pragma omp parallel for schedule(dynamic) shared(args)
+	for (int t = 0; t < verticalTiles * horizontalTiles; t++) {
+		int rowBegin = (t / horizontalTiles) * tileRows;
+		int colBegin = (t % horizontalTiles) * tileCols;
+		int rowEnd = std::min(rowBegin + tileRows, size.height);
+		int colEnd = std::min(colBegin + tileCols, size.width);
+		for (int i = rowBegin; i < rowEnd; i++)
+			Kernels::BilateralRow(args, i, colBegin, colEnd);
+	}
+
+	return outputImage;
+}
+
+/**
+ * @brief Evaluates the Bilateral Filter once per pair of pixels. When both images are fixed the kernel is symmetric,
+ * \f$ \psi_{\text BF}(U, m, p) = \psi_{\text BF}(U, p, m) \f$, so every pixel only evaluates the pairs with the pixels after it
+ * in raster order and accumulates the weight into both numerators and norms, about half of the weights of the exact kernels.
+ * The zeros outside of the image only add to the norm of the pixel inside of it, with the range weight of \f$ ||U(p)||^2 \f$.
+ * The pairs of a row are evaluated by Kernels::SymmetricBilateralRow one window offset at a time, so consecutive pixels
+ * are processed at once with the instruction set selected by the Kernels class.
+ * The rows are split in one band per thread. A band also scatters into the windowSize / 2 rows below it,
+ * so each band accumulates into its own planar buffer of L, a, b and norm sums and the buffers are added afterwards
+ *
+ * @param args kernel arguments
+ * @param outputImage output image
+ */
+void Filters::SymmetricBilateralFilter(const BilateralArgs &args, LabImage &outputImage) {
+	const int padding = args.windowSize / 2;
+	const int rows = args.rows, cols = args.cols;
+	const int bandRows = (rows + omp_get_max_threads() - 1) / omp_get_max_threads();
+	const int bands = (rows + bandRows - 1) / bandRows;
+
+	// The four sum planes of a band are stacked in a single buffer
+	std::vector<Mat> accumulators((std::size_t) bands);
+	for (int band = 0; band < bands; band++) {
+		const int rowBegin = band * bandRows, rowEnd = std::min(rowBegin + bandRows, rows);
+		const int bandHeight = std::min(rowEnd + padding, rows) - rowBegin;
+		accumulators[(std::size_t) band] = FrameWorkspace::Acquire(workspace, FrameWorkspace::BAND_ACCUMULATORS, Size(cols, 4 * bandHeight), CV_32FC1, band);
+	}
+	auto sumRow = [&accumulators, bandRows](int band, int channel, int i) {
+		Mat &accumulator = accumulators[(std::size_t) band];
+		return accumulator.ptr<float>(channel * (accumulator.rows / 4) + i - band * bandRows);
+	};
+
+	#pragma omp parallel for schedule(static) shared(args, accumulators)
+	for (int band = 0; band < bands; band++) {
+		const int rowBegin = band * bandRows, rowEnd = std::min(rowBegin + bandRows, rows);
+		Mat &accumulator = accumulators[(std::size_t) band];
+		accumulator.setTo(Scalar::all(0));
+
+		for (int i = rowBegin; i < rowEnd; i++) {
+			float *const sums[4] = {sumRow(band, L, i), sumRow(band, a, i), sumRow(band, b, i), sumRow(band, 3, i)};
+			Kernels::SymmetricBilateralRow(args, i, sums, accumulator.step1());
+		}
+	}
+
+	// Add the bands, a row takes its own band and the bands above it that reach it
+	#pragma omp parallel for shared(accumulators, outputImage)
+	for (int i = 0; i < rows; i++) {
+		float *outputRows[3] = {outputImage.planes[L].ptr<float>(i), outputImage.planes[a].ptr<float>(i), outputImage.planes[b].ptr<float>(i)};
+		const float *sums[4] = {sumRow(i / bandRows, L, i), sumRow(i / bandRows, a, i), sumRow(i / bandRows, b, i), sumRow(i / bandRows, 3, i)};
+		for (int j = 0; j < cols; j++) {
+			float sum[4] = {sums[0][j], sums[1][j], sums[2][j], sums[3][j]};
+			for (int band = i / bandRows - 1; band >= 0 && band * bandRows + accumulators[(std::size_t) band].rows / 4 > i; band--) {
+				for (int channel = 0; channel < 4; channel++) sum[channel] += sumRow(band, channel, i)[j];
+			}
+			for (int channel = L; channel <= b; channel++) outputRows[channel][j] = sum[channel] / sum[3];
+		}
+	}
+}
+
+/**
+ * @brief Approximates the Bilateral Filter through a permutohedral lattice, so its cost is linear in the number of pixels
+ * and does not depend on the window size. Every pixel \f$ m \f$ is placed in the 5D space
+ * \f[ \left( \frac{x_m}{\sigma_s}, \frac{y_m}{\sigma_s}, \frac{U_L(m)}{\sigma_r}, \frac{U_a(m)}{\sigma_r}, \frac{U_b(m)}{\sigma_r} \right) \f]
+ * built from the weighting image, where the product of the spatial and range kernels is a single unit Gaussian.
+ * The input image values \f$ (I(m), 1) \f$ are splatted into the lattice, blurred there and sliced back at the
+ * weighting image positions; the last channel holds the filter's norm.
+ * Unlike the exact filter the Gaussian is not truncated to the window and the pixels outside of the image
+ * do not contribute to the norm
+ *
+ * @param inputImage image used as input for the filter
+ * @param weightingImage image used to calculate the kernel weight
+ * @param spatialSigma spatial standard deviation
+ * @param rangeSigma range or radiometric standard deviation
+ * @return Mat output image
+ */
+LabImage Filters::LatticeBilateralFilter(const LabImage &inputImage, const LabImage &weightingImage, double spatialSigma, double rangeSigma) {
+	const int D = PermutohedralLattice::D, VD = PermutohedralLattice::VD;
+	const float spatialScale = (float) (1.0 / spatialSigma), rangeScale = (float) (1.0 / rangeSigma);
+	const Size size = inputImage.ImageSize();
+	lattice.Reset((std::size_t) size.area(), gridResolution);
+
+	// Position of a pixel in the lattice space
+	auto position = [&](int i, int j, float *p) {
+		p[0] = (float) j * spatialScale;
+		p[1] = (float) i * spatialScale;
+		for (int channel = L; channel <= b; channel++) p[2 + channel] = weightingImage.planes[channel].ptr<float>(i)[j] * rangeScale;
+	};
+
+	// Splat the input values in homogeneous coordinates. The lattice grows while splatting, so this is sequential
+	for (int i = 0; i < size.height; i++) {
+		const float *inputRows[3] = {inputImage.planes[L].ptr<float>(i), inputImage.planes[a].ptr<float>(i), inputImage.planes[b].ptr<float>(i)};
+		for (int j = 0; j < size.width; j++) {
+			float p[D], value[VD] = {inputRows[L][j], inputRows[a][j], inputRows[b][j], 1.0f};
+			position(i, j, p);
+			lattice.Splat(p, value);
+		}
+	}
+
+	lattice.Blur();
+
+	// Slice at the weighting image positions and normalize
+	LabImage outputImage = FrameWorkspace::AcquireLab(workspace, FrameWorkspace::FILTERED_IMAGE, size);
+	#pragma omp parallel for shared(lattice, outputImage)
+	for (int i = 0; i < size.height; i++) {
+		float *outputRows[3] = {outputImage.planes[L].ptr<float>(i), outputImage.planes[a].ptr<float>(i), outputImage.planes[b].ptr<float>(i)};
+		for (int j = 0; j < size.width; j++) {
+			float p[D], value[VD];
+			position(i, j, p);
+			lattice.Slice(p, value);
+			for (int channel = L; channel <= b; channel++) outputRows[channel][j] = value[channel] / value[VD - 1];
+		}
+	}
+
+	return outputImage;
+}
+
+/**
+ * @brief Expands a 1D Gaussian range kernel into raised cosine terms, after K. N. Chaudhury, D. Sage and M. Unser,
+ * "Fast O(1) bilateral filtering using trigonometric range kernels", 2011. On the interval \f$ [-T, T] \f$
+ * \f[ \exp\left( -\frac{t^2}{2 \sigma_r^2} \right) \approx \cos^N\left( \frac{\gamma t}{\sqrt{N}} \right)
+ * = \sum_{n = 0}^{N} \binom{N}{n} 2^{-N} \exp\left( i (2n - N) \frac{\gamma t}{\sqrt{N}} \right), \quad \gamma = \frac{1}{\sigma_r} \f]
+ * where \f$ N \geq (2 \gamma T / \pi)^2 \f$ keeps the raised cosine positive and monotonic on the interval.
+ * Only the central binomial terms are kept, until their coefficients add up to \f$ 1 - \epsilon / 2 \f$.
+ * The order \f$ N \f$ is the smallest one whose truncated expansion stays within \f$ \epsilon \f$ of the Gaussian
+ * on the interval. The search fails with an error past \f$ N = 4 N_0 + 1000 \f$, \f$ N_0 \f$ being the bound above
+ *
+ * @param range largest absolute argument \f$ T \f$
+ * @param rangeSigma range standard deviation
+ * @param tolerance largest absolute error \f$ \epsilon \f$ of the expansion
+ * @param harmonics kept harmonics \f$ 2n - N \f$
+ * @param coefficients kept coefficients
+ * @param frequency base frequency \f$ \gamma / \sqrt{N} \f$
+ */
+void Filters::RaisedCosineTerms(double range, double rangeSigma, double tolerance, std::vector<int> &harmonics, std::vector<double> &coefficients, double &frequency) {
+	const double gamma = 1.0 / rangeSigma;
+	const int minOrder = std::max(1, (int) std::ceil(pow(2.0 * gamma * range / CV_PI, 2.0)));
+	const int samples = 256;
+
+	for (int order = minOrder;; order++) {
+		harmonics.clear();
+		coefficients.clear();
+		frequency = gamma / std::sqrt((double) order);
+
+		// Binomial coefficients from the center outwards, in the log domain as the order can be large
+		auto coefficient = [order](int n) {
+			return std::exp(std::lgamma(order + 1.0) - std::lgamma(n + 1.0) - std::lgamma(order - n + 1.0) - order * std::log(2.0));
+		};
+		double mass = 0.0;
+		for (int low = order / 2, high = (order + 1) / 2; low >= 0 && mass < 1.0 - tolerance / 2.0; low--, high++) {
+			harmonics.push_back(2 * low - order);
+			coefficients.push_back(coefficient(low));
+			mass += coefficients.back();
+			if (high != low) {
+				harmonics.push_back(2 * high - order);
+				coefficients.push_back(coefficient(high));
+				mass += coefficients.back();
+			}
 		}
+
+		// Largest error on the interval. The raised cosine tends to the Gaussian as the order grows
+		double error = 0.0;
+		for (int k = 0; k <= samples && range > 0.0; k++) {
+			double t = range * k / samples, approximation = 0.0;
+			for (std::size_t n = 0; n < harmonics.size(); n++) approximation += coefficients[n] * std::cos(harmonics[n] * frequency * t);
+			error = std::max(error, std::abs(approximation - std::exp(-pow(gamma * t, 2.0) / 2.0)));
+		}
+		if (error <= tolerance) return;
+		if (order >= 4 * minOrder + 1000)
+			CV_Error(Error::StsOutOfRange, "The trigonometric expansion does not reach the tolerance, raise the range sigma or the tolerance");
+	}
+}
+
+/**
+ * @brief Approximates the Bilateral Filter with a shiftable trigonometric range kernel, so each expansion term
+ * reduces to a spatial Gaussian convolution whose cost does not depend on the range weights.
+ * The 3D range kernel is the product of one raised cosine expansion per CIELab channel, so every term is a
+ * harmonic \f$ \omega \f$ with coefficient \f$ c_\omega \f$ and
+ * \f[ G_{\text range}(W(m) - W(p)) \approx \sum_\omega c_\omega \, \overline{h_\omega(p)} \, h_\omega(m),
+ * \quad h_\omega(m) = \exp\left( i \, \omega \cdot W(m) \right) \f]
+ * The numerator and the norm of the filter then become
+ * \f[ \sum_\omega c_\omega \, \overline{h_\omega(p)} \, \left( G_{\text spatial} * (h_\omega U) \right)(p), \quad
+ * \sum_\omega c_\omega \, \overline{h_\omega(p)} \, \left( G_{\text spatial} * h_\omega \right)(p) \f]
+ * The conjugate harmonics \f$ \pm \omega \f$ give conjugate terms, so only one of each pair is evaluated.
+ * The number of terms follows from each channel's dynamic range, rangeSigma and the accuracy target trigTolerance,
+ * the largest error of the range kernel, which is split evenly between the channels. It grows quickly with the
+ * dynamic range over rangeSigma, so this engine suits large range sigmas (about 20 or more in CIELab units).
+ * Pixels outside the image do not contribute to the norm
+ *
+ * @param inputImage image used as input for the filter
+ * @param weightingImage image used to calculate the kernel weight
+ * @param windowSize processing window size, the extent of the spatial Gaussian
+ * @param spatialSigma spatial standard deviation
+ * @param rangeSigma range or radiometric standard deviation
+ * @return Mat output image
+ */
+LabImage Filters::TrigonometricBilateralFilter(const LabImage &inputImage, const LabImage &weightingImage, int windowSize, double spatialSigma, double rangeSigma) {
+	const Mat *weightingChannels = weightingImage.planes;
+	const Size size = inputImage.ImageSize();
+
+	// Expansion of each channel over its dynamic range
+	std::vector<int> harmonics[3];
+	std::vector<double> coefficients[3];
+	double frequency[3], minValue, maxValue;
+	std::size_t terms = 1;
+	for (int channel = L; channel <= b; channel++) {
+		minMaxLoc(weightingChannels[channel], &minValue, &maxValue);
+		RaisedCosineTerms(maxValue - minValue, rangeSigma, trigTolerance / 3.0, harmonics[channel], coefficients[channel], frequency[channel]);
+		terms *= harmonics[channel].size();
 	}
+	if (terms > 2 * MAX_TRIGONOMETRIC_TERMS)
+		CV_Error(Error::StsOutOfRange, "The trigonometric expansion needs too many terms, raise the range sigma or the tolerance");
 
-	// Discard the padding
-	xRange = Range(padding, inputImage.rows - padding);
-	yRange = Range(padding, inputImage.cols - padding);
+	// Accumulated numerator (three channels) and norm
+	Mat accumulator = FrameWorkspace::Acquire(workspace, FrameWorkspace::ENGINE_SCRATCH, size, CV_32FC4);
+	accumulator.setTo(Scalar::all(0));
+	Mat termImage = FrameWorkspace::Acquire(workspace, FrameWorkspace::ENGINE_SCRATCH, size, CV_32FC(8), 0);
+	Mat blurredImage = FrameWorkspace::Acquire(workspace, FrameWorkspace::ENGINE_SCRATCH, size, CV_32FC(8), 1);
+	const Mat &gaussianRow = utilsLib.GaussianRowKernel(windowSize, spatialSigma);
 
-	return outputImage(xRange, yRange);
+	for (std::size_t kL = 0; kL < harmonics[L].size(); kL++)
+	for (std::size_t kA = 0; kA < harmonics[a].size(); kA++)
+	for (std::size_t kB = 0; kB < harmonics[b].size(); kB++) {
+		// Evaluate one harmonic of each conjugate pair, the zero harmonic is its own conjugate
+		int harmonic[3] = {harmonics[L][kL], harmonics[a][kA], harmonics[b][kB]};
+		int sign = harmonic[L] != 0 ? harmonic[L] : harmonic[a] != 0 ? harmonic[a] : harmonic[b];
+		if (sign < 0) continue;
+		const float coefficient = (float) ((sign > 0 ? 2.0 : 1.0) * coefficients[L][kL] * coefficients[a][kA] * coefficients[b][kB]);
+		float omega[3];
+		for (int channel = L; channel <= b; channel++) omega[channel] = (float) (harmonic[channel] * frequency[channel]);
+
+		// Real and imaginary parts of h and h U
+		#pragma omp parallel for shared(termImage)
+		for (int i = 0; i < termImage.rows; i++) {
+			const float *wL = weightingChannels[L].ptr<float>(i), *wA = weightingChannels[a].ptr<float>(i), *wB = weightingChannels[b].ptr<float>(i);
+			const float *iL = inputImage.planes[L].ptr<float>(i), *iA = inputImage.planes[a].ptr<float>(i), *iB = inputImage.planes[b].ptr<float>(i);
+			Vec<float, 8> *termRow = termImage.ptr<Vec<float, 8>>(i);
+			for (int j = 0; j < termImage.cols; j++) {
+				float phase = omega[L] * wL[j] + omega[a] * wA[j] + omega[b] * wB[j];
+				float cosine = std::cos(phase), sine = std::sin(phase);
+				termRow[j] = Vec<float, 8>(cosine, sine,
+					cosine * iL[j], sine * iL[j],
+					cosine * iA[j], sine * iA[j],
+					cosine * iB[j], sine * iB[j]);
+			}
+		}
+
+		cv::sepFilter2D(termImage, blurredImage, -1, gaussianRow, gaussianRow, Point(-1, -1), 0.0, BORDER_CONSTANT);
+
+		// Real part of the blurred values times the conjugate of h at the center pixel
+		#pragma omp parallel for shared(accumulator, blurredImage)
+		for (int i = 0; i < accumulator.rows; i++) {
+			const Vec<float, 8> *termRow = termImage.ptr<Vec<float, 8>>(i);
+			const Vec<float, 8> *blurredRow = blurredImage.ptr<Vec<float, 8>>(i);
+			Vec4f *accumulatorRow = accumulator.ptr<Vec4f>(i);
+			for (int j = 0; j < accumulator.cols; j++) {
+				float cosine = coefficient * termRow[j][0], sine = coefficient * termRow[j][1];
+				accumulatorRow[j][L] += cosine * blurredRow[j][2] + sine * blurredRow[j][3];
+				accumulatorRow[j][a] += cosine * blurredRow[j][4] + sine * blurredRow[j][5];
+				accumulatorRow[j][b] += cosine * blurredRow[j][6] + sine * blurredRow[j][7];
+				accumulatorRow[j][3] += cosine * blurredRow[j][0] + sine * blurredRow[j][1];
+			}
+		}
+	}
+
+	// Normalize
+	LabImage outputImage = FrameWorkspace::AcquireLab(workspace, FrameWorkspace::FILTERED_IMAGE, size);
+	#pragma omp parallel for shared(accumulator, outputImage)
+	for (int i = 0; i < size.height; i++) {
+		const Vec4f *accumulatorRow = accumulator.ptr<Vec4f>(i);
+		for (int channel = L; channel <= b; channel++) {
+			float *outputRow = outputImage.planes[channel].ptr<float>(i);
+			for (int j = 0; j < size.width; j++) outputRow[j] = accumulatorRow[j][channel] / accumulatorRow[j][3];
+		}
+	}
+
+	return outputImage;
 }
 
 /**
@@ -127,7 +427,7 @@ Mat Filters::BilateralFilter(const Mat &inputImage_, const Mat &weightingImage_,
  * @param rangeSigma range or radiometric standard deviation
  * @return Mat output image
  */
-Mat Filters::ScaledBilateralFilter(const Mat &inputImage, const Mat &weightingImage, int windowSize, double spatialSigma, double rangeSigma) {
+LabImage Filters::ScaledBilateralFilter(const LabImage &inputImage, const LabImage &weightingImage, int windowSize, double spatialSigma, double rangeSigma) {
 	/* This filter uses a low pass filtered version of the input image as part of the weighting input.
 	 *  In this case with a Gaussian blur as LPF.
 	 */
@@ -157,8 +457,12 @@ Mat Filters::ScaledBilateralFilter(const Mat &inputImage, const Mat &weightingIm
 	 * \f[ Y_{\psi_{\text SBF}}(p) = \left( \sum_{m \subset \Omega} \psi_{\text SBF}(U^s, U, m, p) \right)^{-1}
 	 * \left( \sum_{m \subset \Omega} \psi_{\text SBF}(U^s, U, m, p) \, U(m) \right) \f]
 	 */
-	Mat scaledImage(weightingImage.size(), weightingImage.type());
-	cv::GaussianBlur(weightingImage, scaledImage, Size(windowSize, windowSize), spatialSigma, 0.0, BORDER_CONSTANT);
+	LabImage scaledImage = FrameWorkspace::AcquireLab(workspace, FrameWorkspace::SCALED_IMAGE, weightingImage.ImageSize());
+	const Mat &gaussianRow = utilsLib.GaussianRowKernel(windowSize, spatialSigma);
+	for (int channel = L; channel <= b; channel++)
+		cv::sepFilter2D(weightingImage.planes[channel], scaledImage.planes[channel], -1, gaussianRow, gaussianRow, Point(-1, -1), 0.0, BORDER_CONSTANT);
+
+	// The bilateral stage runs with the same tiling
 	return Filters::BilateralFilter(inputImage, scaledImage, windowSize, spatialSigma, rangeSigma);
 }
 
@@ -174,87 +478,533 @@ Mat Filters::ScaledBilateralFilter(const Mat &inputImage, const Mat &weightingIm
  * @param rangeSigma range or radiometric standard deviation. Used to calculate the parameter \f$ h^2 = 2 \sigma_r^2 \f$
  * @return Mat output image
  */
-Mat Filters::NonLocalMeansFilter(const Mat &inputImage_, const Mat &weightingImage_, int windowSize, int neighborhoodSize, double rangeSigma) {
+LabImage Filters::NonLocalMeansFilter(const LabImage &inputImage_, const LabImage &weightingImage_, int windowSize, int neighborhoodSize, double rangeSigma) {
+	// The integral engine does not grow with the neighborhood size
+	if (engine == INTEGRAL) return IntegralNonLocalMeansFilter(inputImage_, weightingImage_, windowSize, neighborhoodSize, rangeSigma);
+	if (engine == PCA) return PCANonLocalMeansFilter(inputImage_, weightingImage_, windowSize, neighborhoodSize, rangeSigma);
+
 	// Set the padding value
 	int padding = (windowSize - 1) / 2;
 
-	// Working images
-	Mat inputImage, weightingImage;
-
-	// Add padding to the input for kernel consistency
-	copyMakeBorder(inputImage_, inputImage, padding, padding, padding, padding, BORDER_CONSTANT);
-	copyMakeBorder(weightingImage_, weightingImage, padding, padding, padding, padding, BORDER_CONSTANT);
-
 	// NML standard deviation h
 	double h = rangeSigma;
 
-	// Prepare variables for the bilateral filtering
-	Mat outputImage(inputImage.size(), inputImage.type());
-	Mat inputRegion, weightRegion, euclideanDistance;
-	Mat dL, da, db;
-	Mat nonLocalMeansFilter;
-	double nonLocalMeansFilterNorm;
-	Range xRange, yRange;
-	Vec3f pixel;
-	Mat inputChannels[3], weightChannels[3], nlmChannels[3];
-	int iMin, iMax, jMin, jMax;
+	/**
+	 * The NLM weights are evaluated over the CIELab planes of the input image, so consecutive window pixels are
+	 * evaluated at once with the instruction set selected by the Kernels class. The pixels outside of the image
+	 * are zeros, the kernels handle them for the input and the patch distances read the windows in place from
+	 * a single zero padded copy of the weighting planes
+	 */
+	const Size size = inputImage_.ImageSize();
+	LabImage weightingImage = FrameWorkspace::AcquireLab(workspace, FrameWorkspace::PADDED_WEIGHTING, Size(size.width + 2 * padding, size.height + 2 * padding));
+	for (int channel = L; channel <= b; channel++)
+		copyMakeBorder(weightingImage_.planes[channel], weightingImage.planes[channel], padding, padding, padding, padding, BORDER_CONSTANT);
+	const Mat *weightingChannels = weightingImage.planes;
 
-	// Set the parallelization pragma for OpenMP
-	#pragma omp parallel for\
-	private(iMin, iMax, jMin, jMax, xRange, yRange, pixel, dL, da, db, euclideanDistance,\
-	nlmChannels, nonLocalMeansFilter, nonLocalMeansFilterNorm, weightRegion, weightChannels, inputRegion, inputChannels)\
-	shared(inputImage, weightingImage, outputImage, windowSize, neighborhoodSize, rangeSigma)
-	for (int i = padding; i < inputImage.rows - padding; i++) {
-		iMin = i - padding;
-		iMax = iMin + windowSize;
-		xRange = Range(iMin, iMax);
-		for (int j = padding; j < inputImage.cols - padding; j++) {
-			jMin = j - padding;
-			jMax = jMin + windowSize;
-			yRange = Range(jMin, jMax);
-
-			// Extract local region based on the window size
-			weightRegion = weightingImage(xRange, yRange);
-
-			/**
-			 * The discrete representation of the Non Local Means Filter is as follows:
-			 * \f[ \psi_{\text {NLM}}(U, m, p) = \sum_{B(m) \subseteq U} \exp\left( \frac{||B(m) - B(p)||^2 - 2 \sigma_r^2}{h^2} \right)\f]
-			 * where  \f$B(p)\f$ is a patch part of the window \f$\Omega\f$ centered at pixel \f$p\f$. \f$B(m)\f$ represents all of the
-			 * patches at \f$\Omega\f$ centered in each \f$m\f$ pixel. The Non Local Means Filter calculates the Euclidean distance
-			 * between  each patch \f$B(m)\f$ and \f$B(p)\f$ for each window \f$\Omega \subseteq U\f$. This is why this algorithm is
-			 * demanding in computational terms. Each Euclidean distance matrix obtained from each patch pair is the input for
-			 * a Gaussian decreasing function with standard deviation \f$h\f$ that generates the new pixel \f$p\f$ value.
-			 */
-			cv::split(weightRegion, weightChannels);
-			euclideanDistance =
-				utilsLib.EuclideanDistancesMatrix(weightChannels[L], windowSize, neighborhoodSize)
-			+ 	utilsLib.EuclideanDistancesMatrix(weightChannels[a], windowSize, neighborhoodSize)
-			+ 	utilsLib.EuclideanDistancesMatrix(weightChannels[b], windowSize, neighborhoodSize);
-			nonLocalMeansFilter = utilsLib.GaussianFunction(euclideanDistance - 2.0 * pow(rangeSigma, 2.0), h);
-
-			/**
-			 * The Non Local Means filter's norm is calculated with:
-			 * \f[\left( \sum_{m \subset \Omega} \psi_{\text{NLM}}(U, m, p) \right)^{-1} \f]
-			 */
-			nonLocalMeansFilterNorm = sum(nonLocalMeansFilter).val[0];
-
-			/**
-			 * The NLM filter kernel is applied to the laplacian image:
-			 * \f[ Y_{\psi_{\text NLM}}(p) = \left( \sum_{m \subset \Omega} \psi_{\text NLM}(U, m, p) \right)^{-1}
-			 * \left( \sum_{m \subset \Omega} \psi_{\text NLM}(U, p, m) \, U(m) \right) \f]
-			 */
-			inputRegion = inputImage(xRange, yRange);
-			cv::split(inputRegion, inputChannels);
-			outputImage.at<Vec3f>(i, j)[L] = (1 / nonLocalMeansFilterNorm) * sum(nonLocalMeansFilter.mul(inputChannels[L])).val[0];
-			outputImage.at<Vec3f>(i, j)[a] = (1 / nonLocalMeansFilterNorm) * sum(nonLocalMeansFilter.mul(inputChannels[a])).val[0];
-			outputImage.at<Vec3f>(i, j)[b] = (1 / nonLocalMeansFilterNorm) * sum(nonLocalMeansFilter.mul(inputChannels[b])).val[0];
+	NonLocalMeansArgs args;
+	for (int channel = L; channel <= b; channel++) args.input[channel] = inputImage_.planes[channel].ptr<float>();
+	args.step = inputImage_.Step();
+	args.rows = size.height;
+	args.cols = size.width;
+	args.windowSize = windowSize;
+	args.weightFactor = (float) (-1.0 / (2.0 * pow(h, 2.0)));
+	args.weightOffset = (float) (2.0 * pow(rangeSigma, 2.0));
+	args.weightLUT = nullptr;
+	if (rangeLUT) {
+		rangeTable.Build(args.weightFactor, args.weightOffset);
+		args.weightLUT = &rangeTable;
+	}
+
+	// Prepare variables for the non local means filtering
+	LabImage outputImage = FrameWorkspace::AcquireLab(workspace, FrameWorkspace::FILTERED_IMAGE, size);
+
+	// The sliding engine reuses the patch distances along the rows
+	if (engine == SLIDING) {
+		SlidingNonLocalMeansFilter(args, weightingImage, windowSize, neighborhoodSize, outputImage);
+		return outputImage;
+	}
+
+	/**
+	 * With pre-selection the mean \f$ \mu \f$ and standard deviation \f$ s \f$ of every patch are taken from box filters.
+	 * For each channel the squared distance of two patches of \f$ n \f$ pixels is bounded by their moments,
+	 * \f[ ||B(m) - B(p)||^2 \geq n \left( (\mu_m - \mu_p)^2 + (s_m - s_p)^2 \right) \f]
+	 * so a candidate whose bound already gives a weight below pruneThreshold times the largest weight is discarded
+	 * before its distance is computed. The bound holds for the patches inside of the window, the moments of the
+	 * ones that replicate the window border are taken from the image instead
+	 */
+	const bool pruning = pruneThreshold > 0.0;
+	const float pruneDistance = pruning ? (float) (std::log(pruneThreshold) / args.weightFactor) : 0.0f;
+	LabImage patchMeans, patchDeviations;
+	if (pruning) {
+		// The patch origins of a window reach windowSize - 1 pixels above and to the left of its center
+		const Size momentsSize(size.width + 2 * padding + neighborhoodSize, size.height + 2 * padding + neighborhoodSize);
+		LabImage momentsImage = FrameWorkspace::AcquireLab(workspace, FrameWorkspace::PATCH_MOMENTS, momentsSize, 0);
+		LabImage squaredImage = FrameWorkspace::AcquireLab(workspace, FrameWorkspace::PATCH_MOMENTS, momentsSize, 1);
+		LabImage squaredMeans = FrameWorkspace::AcquireLab(workspace, FrameWorkspace::PATCH_MOMENTS, momentsSize, 2);
+		patchMeans = FrameWorkspace::AcquireLab(workspace, FrameWorkspace::PATCH_MOMENTS, momentsSize, 3);
+		patchDeviations = FrameWorkspace::AcquireLab(workspace, FrameWorkspace::PATCH_MOMENTS, momentsSize, 4);
+		for (int channel = L; channel <= b; channel++) {
+			copyMakeBorder(weightingImage_.planes[channel], momentsImage.planes[channel], 2 * padding, neighborhoodSize, 2 * padding, neighborhoodSize, BORDER_CONSTANT);
+			cv::multiply(momentsImage.planes[channel], momentsImage.planes[channel], squaredImage.planes[channel]);
+			boxFilter(momentsImage.planes[channel], patchMeans.planes[channel], -1, Size(neighborhoodSize, neighborhoodSize), Point(0, 0), true, BORDER_CONSTANT);
+			boxFilter(squaredImage.planes[channel], squaredMeans.planes[channel], -1, Size(neighborhoodSize, neighborhoodSize), Point(0, 0), true, BORDER_CONSTANT);
+
+			// The variances are computed in place over the squared means
+			cv::multiply(patchMeans.planes[channel], patchMeans.planes[channel], squaredImage.planes[channel]);
+			cv::subtract(squaredMeans.planes[channel], squaredImage.planes[channel], squaredMeans.planes[channel]);
+			cv::max(squaredMeans.planes[channel], 0.0, squaredMeans.planes[channel]);
+			cv::sqrt(squaredMeans.planes[channel], patchDeviations.planes[channel]);
+		}
+	}
+	unsigned long pruned = 0, compared = 0;
+
+	// Set the parallelization pragma for OpenMP, each thread reuses its own distances matrix and candidate flags
+	#pragma omp parallel\
+	shared(args, weightingChannels, outputImage, windowSize, neighborhoodSize, patchMeans, patchDeviations)\
+	reduction(+: pruned, compared)
+	{
+		Mat euclideanDistance = FrameWorkspace::AcquireThread(workspace, FrameWorkspace::THREAD_SCRATCH, Size(windowSize, windowSize), CV_32FC1, 0);
+		Mat candidates = FrameWorkspace::AcquireThread(workspace, FrameWorkspace::THREAD_SCRATCH, Size(windowSize, windowSize), CV_8UC1, 1);
+		#pragma omp for
+		for (int i = 0; i < size.height; i++) {
+			float *outputRows[3] = {outputImage.planes[L].ptr<float>(i), outputImage.planes[a].ptr<float>(i), outputImage.planes[b].ptr<float>(i)};
+			for (int j = 0; j < size.width; j++) {
+				// Discard the candidates whose moments differ too much from the ones of the fixed patch
+				if (pruning) {
+					float fixedMean[3], fixedDeviation[3];
+					for (int c = 0; c < 3; c++) {
+						fixedMean[c] = patchMeans.planes[c].ptr<float>(i + padding)[j + padding];
+						fixedDeviation[c] = patchDeviations.planes[c].ptr<float>(i + padding)[j + padding];
+					}
+					for (int k = 0; k < windowSize; k++) {
+						const float *meanRows[3], *deviationRows[3];
+						for (int c = 0; c < 3; c++) {
+							meanRows[c] = patchMeans.planes[c].ptr<float>(i + k) + j;
+							deviationRows[c] = patchDeviations.planes[c].ptr<float>(i + k) + j;
+						}
+						for (int l = 0; l < windowSize; l++) {
+							float bound = 0.0f;
+							for (int c = 0; c < 3; c++) {
+								float mean = fixedMean[c] - meanRows[c][l], deviation = fixedDeviation[c] - deviationRows[c][l];
+								bound += mean * mean + deviation * deviation;
+							}
+							bool keep = (float) neighborhoodSize * bound <= pruneDistance;
+							candidates.ptr<unsigned char>()[k * windowSize + l] = keep;
+							pruned += !keep;
+						}
+					}
+					compared += (unsigned long) (windowSize * windowSize);
+				}
+
+				/**
+				 * The discrete representation of the Non Local Means Filter is as follows:
+				 * \f[ \psi_{\text {NLM}}(U, m, p) = \sum_{B(m) \subseteq U} \exp\left( \frac{||B(m) - B(p)||^2 - 2 \sigma_r^2}{h^2} \right)\f]
+				 * where  \f$B(p)\f$ is a patch part of the window \f$\Omega\f$ centered at pixel \f$p\f$. \f$B(m)\f$ represents all of the
+				 * patches at \f$\Omega\f$ centered in each \f$m\f$ pixel. The Non Local Means Filter calculates the Euclidean distance
+				 * between  each patch \f$B(m)\f$ and \f$B(p)\f$ for each window \f$\Omega \subseteq U\f$. This is why this algorithm is
+				 * demanding in computational terms. Each Euclidean distance matrix obtained from each patch pair is the input for
+				 * a Gaussian decreasing function with standard deviation \f$h\f$ that generates the new pixel \f$p\f$ value.
+				 */
+				utilsLib.EuclideanDistancesMatrix(weightingChannels, i, j, windowSize, neighborhoodSize, pruning ? candidates.ptr<unsigned char>() : nullptr, euclideanDistance);
+
+				/**
+				 * The Non Local Means filter's norm is calculated with:
+				 * \f[\left( \sum_{m \subset \Omega} \psi_{\text{NLM}}(U, m, p) \right)^{-1} \f]
+				 * and the NLM filter kernel is applied to the laplacian image:
+				 * \f[ Y_{\psi_{\text NLM}}(p) = \left( \sum_{m \subset \Omega} \psi_{\text NLM}(U, m, p) \right)^{-1}
+				 * \left( \sum_{m \subset \Omega} \psi_{\text NLM}(U, p, m) \, U(m) \right) \f]
+				 */
+				float value[3];
+				Kernels::NonLocalMeansPixel(args, euclideanDistance.ptr<float>(), i, j, value);
+				for (int c = 0; c < 3; c++) outputRows[c][j] = value[c];
+			}
+		}
+	}
+	prunedCandidates += pruned;
+	comparedCandidates += compared;
+
+	return outputImage;
+}
+
+/**
+ * @brief Gets the fraction of the NLM candidate patches discarded by the pre-selection since the last reset
+ *
+ * @return double pruned fraction, 0 if no candidate was pre-selected
+ */
+double Filters::PrunedFraction() const {
+	return comparedCandidates ? (double) prunedCandidates / (double) comparedCandidates : 0.0;
+}
+
+/**
+ * @brief Resets the NLM pre-selection counters
+ *
+ */
+void Filters::ResetPruningCounters() {
+	prunedCandidates = 0;
+	comparedCandidates = 0;
+}
+
+/**
+ * @brief Adds the NLM pre-selection counters of another instance, such as a frame parallel worker, and resets them
+ *
+ * @param other instance whose counters are moved
+ */
+void Filters::MergePruningCounters(Filters &other) {
+	prunedCandidates += other.prunedCandidates;
+	comparedCandidates += other.comparedCandidates;
+	other.ResetPruningCounters();
+}
+
+/**
+ * @brief Evaluates the Non Local Means Filter with the patch distances of the exact engine, reusing them across the
+ * columns of a row. For a window offset the patch distance is a sum of neighborhoodSize column distances, and the
+ * pixel at the next column shares all of them but one. Each offset keeps the column distances of the last pixel
+ * in a ring, so moving to the next column only evaluates the entering column: \f$ O(\text{neighborhoodSize}) \f$
+ * per offset instead of \f$ O(\text{neighborhoodSize}^2) \f$. The columns of the patches that leave the window
+ * replicate its border, they do not slide and are evaluated directly.
+ * The sums are accumulated in double precision as in the exact engine, only their order changes.
+ * The rows are processed in bands, one band per thread at a time
+ *
+ * @param args non local means kernel arguments
+ * @param weightingImage weighting image, zero padded by windowSize / 2 pixels
+ * @param windowSize processing window size
+ * @param neighborhoodSize patch size
+ * @param outputImage output image
+ */
+void Filters::SlidingNonLocalMeansFilter(const NonLocalMeansArgs &args, const LabImage &weightingImage, int windowSize, int neighborhoodSize, LabImage &outputImage) {
+	const int padding = windowSize / 2;
+	const int offsets = windowSize * windowSize;
+	const int bandRows = 8;
+	const int bands = (args.rows + bandRows - 1) / bandRows;
+	const std::size_t step = weightingImage.Step();
+	const float *planes[3] = {weightingImage.planes[L].ptr<float>(), weightingImage.planes[a].ptr<float>(), weightingImage.planes[b].ptr<float>()};
+	auto clamp = [windowSize](int index) { return std::min(std::max(index, 0), windowSize - 1); };
+
+	#pragma omp parallel shared(args, planes, outputImage)
+	{
+		// Column distance ring of every offset and channel, and the patch distances of a pixel
+		Mat columns = FrameWorkspace::AcquireThread(workspace, FrameWorkspace::THREAD_SCRATCH, Size(3 * neighborhoodSize, offsets), CV_64FC1, 0);
+		Mat distances = FrameWorkspace::AcquireThread(workspace, FrameWorkspace::THREAD_SCRATCH, Size(offsets, 1), CV_32FC1, 1);
+
+		#pragma omp for schedule(dynamic)
+		for (int band = 0; band < bands; band++) {
+			for (int i = band * bandRows; i < std::min((band + 1) * bandRows, args.rows); i++) {
+				float *outputRows[3] = {outputImage.planes[L].ptr<float>(i), outputImage.planes[a].ptr<float>(i), outputImage.planes[b].ptr<float>(i)};
+				for (int j = 0; j < args.cols; j++) {
+					for (int k = 0; k < windowSize; k++) {
+						// Window rows of the patch pixels, the window starts at (i, j) in the padded planes
+						auto columnDistance = [&](int c, int fixedCol, int slidingCol) {
+							double distance = 0.0;
+							for (int r = 0; r < neighborhoodSize; r++) {
+								const float *fixedRow = planes[c] + (std::size_t) (i + clamp(r)) * step;
+								const float *slidingRow = planes[c] + (std::size_t) (i + clamp(k - padding + r)) * step;
+								double difference = (double) fixedRow[fixedCol] - (double) slidingRow[slidingCol];
+								distance += difference * difference;
+							}
+							return distance;
+						};
+
+						for (int l = 0; l < windowSize; l++) {
+							// Patch columns whose fixed and sliding columns stay inside the window
+							const int shift = l - padding;
+							const int insideBegin = std::min(std::max(-shift, 0), neighborhoodSize);
+							const int insideEnd = std::max(insideBegin, std::min({neighborhoodSize, windowSize, windowSize - shift}));
+							double *ring = columns.ptr<double>(k * windowSize + l);
+
+							// Only the entering column is new after the first pixel of the row, offsets that shift every
+							// patch column out of the window (-shift >= neighborhoodSize) have no sliding columns at all
+							if (insideBegin < insideEnd) {
+								for (int column = (j == 0 ? insideBegin : std::max(insideBegin, insideEnd - 1)); column < insideEnd; column++) {
+									const int x = j + column;
+									for (int c = 0; c < 3; c++) ring[c * neighborhoodSize + x % neighborhoodSize] = columnDistance(c, x, x + shift);
+								}
+							}
+
+							double patchDistance[3] = {0.0, 0.0, 0.0};
+							for (int c = 0; c < 3; c++) {
+								for (int column = insideBegin; column < insideEnd; column++)
+									patchDistance[c] += ring[c * neighborhoodSize + (j + column) % neighborhoodSize];
+								for (int column = 0; column < neighborhoodSize; column++) {
+									if (column >= insideBegin && column < insideEnd) continue;
+									patchDistance[c] += columnDistance(c, j + clamp(column), j + clamp(shift + column));
+								}
+							}
+							distances.ptr<float>()[k * windowSize + l] = (float) patchDistance[0] / (float) neighborhoodSize
+								+ (float) patchDistance[1] / (float) neighborhoodSize
+								+ (float) patchDistance[2] / (float) neighborhoodSize;
+						}
+					}
+					float value[3];
+					Kernels::NonLocalMeansPixel(args, distances.ptr<float>(), i, j, value);
+					for (int c = 0; c < 3; c++) outputRows[c][j] = value[c];
+				}
+			}
+		}
+	}
+}
+
+/**
+ * @brief Approximates the Non Local Means Filter by comparing low dimensional patch descriptors. A patch holds
+ * \f$ 3 \, \text{neighborhoodSize}^2 \f$ CIELab values, a PCA basis of pcaDimensions vectors is learned from about
+ * PCA_SAMPLES patches of the weighting image and every patch is projected once on it. As the basis is orthonormal
+ * the squared distance of two descriptors approximates the one of their patches, and it only costs pcaDimensions
+ * operations per pair. The patch values are gathered plane by plane, and since the basis is learned on the same
+ * layout their order does not change the distances. The patches keep the alignment of the integral engine, without the window border replication
+ * of the exact engine, and the pixels outside of the image are zeros
+ *
+ * @param weightingImage image used to calculate the kernel's weight
+ * @param inputImage image used as input for the filter
+ * @param windowSize processing window size
+ * @param neighborhoodSize patch size
+ * @param rangeSigma range or radiometric standard deviation
+ * @return Mat output image
+ */
+LabImage Filters::PCANonLocalMeansFilter(const LabImage &inputImage, const LabImage &weightingImage, int windowSize, int neighborhoodSize, double rangeSigma) {
+	const int padding = (windowSize - 1) / 2;
+	const int rows = inputImage.ImageSize().height, cols = inputImage.ImageSize().width;
+	const int patchSize = 3 * neighborhoodSize * neighborhoodSize;
+	const int maxDimensions = std::min(pcaDimensions, patchSize);
+
+	// Descriptors of every patch compared by the pixels of the image, up to windowSize / 2 pixels outside of it
+	const int descriptorRows = rows + 2 * padding, descriptorCols = cols + 2 * padding;
+	LabImage paddedWeighting = FrameWorkspace::AcquireLab(workspace, FrameWorkspace::PADDED_WEIGHTING, Size(cols + 2 * padding + neighborhoodSize, rows + 2 * padding + neighborhoodSize));
+	for (int channel = L; channel <= b; channel++)
+		copyMakeBorder(weightingImage.planes[channel], paddedWeighting.planes[channel], 2 * padding, neighborhoodSize, 2 * padding, neighborhoodSize, BORDER_CONSTANT);
+	auto gatherPatch = [&](int y, int x, float *patch) {
+		// The patch of the descriptor (y, x) starts at its pixel minus windowSize / 2
+		for (int channel = L; channel <= b; channel++) {
+			for (int k = 0; k < neighborhoodSize; k++) {
+				const float *row = paddedWeighting.planes[channel].ptr<float>(y + k) + x;
+				std::copy(row, row + neighborhoodSize, patch + (channel * neighborhoodSize + k) * neighborhoodSize);
+			}
+		}
+	};
+
+	// Learn the basis from patches sampled on a regular grid
+	const int stride = std::max(1, (int) std::sqrt((double) descriptorRows * descriptorCols / PCA_SAMPLES));
+	const int sampleRows = (descriptorRows + stride - 1) / stride, sampleCols = (descriptorCols + stride - 1) / stride;
+	Mat samples = FrameWorkspace::Acquire(workspace, FrameWorkspace::ENGINE_SCRATCH, Size(patchSize, sampleRows * sampleCols), CV_32F, 0);
+	#pragma omp parallel for shared(samples)
+	for (int i = 0; i < sampleRows; i++)
+		for (int j = 0; j < sampleCols; j++)
+			gatherPatch(i * stride, j * stride, samples.ptr<float>(i * sampleCols + j));
+
+	// The basis is fitted as cv::PCA does, the eigenvectors of the sample covariance by decreasing eigenvalue, with
+	// its mean, covariance and eigen decomposition kept in the workspace
+	Mat basisMean = FrameWorkspace::Acquire(workspace, FrameWorkspace::ENGINE_SCRATCH, Size(patchSize, 1), CV_32F, 2);
+	Mat covariance = FrameWorkspace::Acquire(workspace, FrameWorkspace::ENGINE_SCRATCH, Size(patchSize, patchSize), CV_32F, 3);
+	Mat eigenvalues = FrameWorkspace::Acquire(workspace, FrameWorkspace::ENGINE_SCRATCH, Size(1, patchSize), CV_32F, 4);
+	Mat eigenvectors = FrameWorkspace::Acquire(workspace, FrameWorkspace::ENGINE_SCRATCH, Size(patchSize, patchSize), CV_32F, 5);
+	calcCovarMatrix(samples, covariance, basisMean, COVAR_NORMAL | COVAR_ROWS | COVAR_SCALE, CV_32F);
+	eigen(covariance, eigenvalues, eigenvectors);
+
+	// Project every patch, a basis learned from fewer samples than dimensions has fewer meaningful eigenvectors
+	const int dimensions = std::min(maxDimensions, samples.rows);
+	Mat descriptors = FrameWorkspace::Acquire(workspace, FrameWorkspace::ENGINE_SCRATCH, Size(dimensions, descriptorRows * descriptorCols), CV_32F, 1);
+	#pragma omp parallel shared(basisMean, eigenvectors, descriptors)
+	{
+		Mat patchBuffer = FrameWorkspace::AcquireThread(workspace, FrameWorkspace::THREAD_SCRATCH, Size(patchSize, 1), CV_32FC1, 0);
+		float *patch = patchBuffer.ptr<float>();
+		const float *mean = basisMean.ptr<float>();
+		#pragma omp for
+		for (int y = 0; y < descriptorRows; y++) {
+			for (int x = 0; x < descriptorCols; x++) {
+				gatherPatch(y, x, patch);
+				for (int t = 0; t < patchSize; t++) patch[t] -= mean[t];
+				float *descriptor = descriptors.ptr<float>(y * descriptorCols + x);
+				for (int d = 0; d < dimensions; d++) {
+					const float *eigenvector = eigenvectors.ptr<float>(d);
+					float projection = 0.0f;
+					for (int t = 0; t < patchSize; t++) projection += eigenvector[t] * patch[t];
+					descriptor[d] = projection;
+				}
+			}
+		}
+	}
+
+	// The weights are applied by the exact engine kernels
+	NonLocalMeansArgs args;
+	for (int channel = L; channel <= b; channel++) args.input[channel] = inputImage.planes[channel].ptr<float>();
+	args.step = inputImage.Step();
+	args.rows = rows;
+	args.cols = cols;
+	args.windowSize = windowSize;
+	args.weightFactor = (float) (-1.0 / (2.0 * pow(rangeSigma, 2.0)));
+	args.weightOffset = (float) (2.0 * pow(rangeSigma, 2.0));
+	args.weightLUT = nullptr;
+	if (rangeLUT) {
+		rangeTable.Build(args.weightFactor, args.weightOffset);
+		args.weightLUT = &rangeTable;
+	}
+
+	LabImage outputImage = FrameWorkspace::AcquireLab(workspace, FrameWorkspace::FILTERED_IMAGE, Size(cols, rows));
+	#pragma omp parallel shared(args, descriptors, outputImage)
+	{
+		Mat distanceBuffer = FrameWorkspace::AcquireThread(workspace, FrameWorkspace::THREAD_SCRATCH, Size(windowSize * windowSize, 1), CV_32FC1, 1);
+		float *distances = distanceBuffer.ptr<float>();
+		#pragma omp for
+		for (int i = 0; i < rows; i++) {
+			float *outputRows[3] = {outputImage.planes[L].ptr<float>(i), outputImage.planes[a].ptr<float>(i), outputImage.planes[b].ptr<float>(i)};
+			for (int j = 0; j < cols; j++) {
+				const float *fixed = descriptors.ptr<float>((i + padding) * descriptorCols + j + padding);
+				for (int k = 0; k < windowSize; k++) {
+					for (int l = 0; l < windowSize; l++) {
+						const float *sliding = descriptors.ptr<float>((i + k) * descriptorCols + j + l);
+						float distance = 0.0f;
+						for (int d = 0; d < dimensions; d++) distance += (fixed[d] - sliding[d]) * (fixed[d] - sliding[d]);
+						distances[k * windowSize + l] = distance / (float) neighborhoodSize;
+					}
+				}
+				float value[3];
+				Kernels::NonLocalMeansPixel(args, distances, i, j, value);
+				for (int c = 0; c < 3; c++) outputRows[c][j] = value[c];
+			}
+		}
+	}
+
+	return outputImage;
+}
+
+/**
+ * @brief Approximates the Non Local Means Filter through integral images, so its cost per pixel is
+ * \f$ O(\text{windowSize}^2) \f$ and does not depend on the neighborhood size. The window is visited one offset
+ * \f$ o \f$ at a time for the whole image: the squared CIELab differences
+ * \f[ D_o(m) = ||U(m) - U(m + o)||^2 \f]
+ * are summed into an integral image, so the distance of every patch pair is read with four lookups.
+ * The patches keep the alignment of the exact engine, with their first pixel windowSize / 2 pixels above and to
+ * the left of the pixel. The exact engine replicates the window border for the patches that leave the window,
+ * here they keep reading the image, so both engines only match for the offsets whose patches stay inside the window.
+ * Without that border the patch distance is symmetric, which the symmetric mode exploits.
+ * The pixels outside of the image are zeros as in the exact engine
+ *
+ * @param weightingImage image used to calculate the kernel's weight
+ * @param inputImage image used as input for the filter
+ * @param windowSize processing window size
+ * @param neighborhoodSize patch size
+ * @param rangeSigma range or radiometric standard deviation
+ * @return Mat output image
+ */
+LabImage Filters::IntegralNonLocalMeansFilter(const LabImage &inputImage, const LabImage &weightingImage, int windowSize, int neighborhoodSize, double rangeSigma) {
+	const int padding = (windowSize - 1) / 2;
+	const int rows = inputImage.ImageSize().height, cols = inputImage.ImageSize().width;
+
+	// Same weights as the exact engine
+	const float weightFactor = (float) (-1.0 / (2.0 * pow(rangeSigma, 2.0)));
+	const float weightOffset = (float) (2.0 * pow(rangeSigma, 2.0));
+	const GaussianLUT *weightLUT = nullptr;
+	if (rangeLUT) {
+		rangeTable.Build(weightFactor, weightOffset);
+		weightLUT = &rangeTable;
+	}
+
+	/**
+	 * The patch distance is symmetric, \f$ D_{-o} \f$ is \f$ D_o \f$ shifted by \f$ o \f$. In symmetric mode only half of the
+	 * offsets are visited and their weights are also used for the mirrored offset, so the weights are evaluated
+	 * once per pair of pixels. The weights are then needed for the pixels up to windowSize / 2 pixels outside of the image
+	 */
+	const int extension = symmetric ? padding : 0;
+	const int weightRows = rows + 2 * extension, weightCols = cols + 2 * extension;
+
+	// Zero padding wide enough for the patches of the farthest offsets
+	const int border = 3 * padding + neighborhoodSize;
+	const Size paddedSize(cols + 2 * border, rows + 2 * border);
+	LabImage paddedWeighting = FrameWorkspace::AcquireLab(workspace, FrameWorkspace::PADDED_WEIGHTING, paddedSize);
+	LabImage paddedInput = FrameWorkspace::AcquireLab(workspace, FrameWorkspace::PADDED_INPUT, paddedSize);
+	for (int channel = L; channel <= b; channel++) {
+		copyMakeBorder(weightingImage.planes[channel], paddedWeighting.planes[channel], border, border, border, border, BORDER_CONSTANT);
+		copyMakeBorder(inputImage.planes[channel], paddedInput.planes[channel], border, border, border, border, BORDER_CONSTANT);
+	}
+	const Mat *weightingChannels = paddedWeighting.planes, *inputChannels = paddedInput.planes;
+
+	// Differences at every patch pixel of the weighted pixels, the first one is windowSize / 2 pixels up and left
+	const int differenceRows = weightRows + neighborhoodSize - 1, differenceCols = weightCols + neighborhoodSize - 1;
+	const int origin = border - padding - extension;
+	Mat differences = FrameWorkspace::Acquire(workspace, FrameWorkspace::ENGINE_SCRATCH, Size(differenceCols, differenceRows), CV_32F, 0);
+	Mat weights = FrameWorkspace::Acquire(workspace, FrameWorkspace::ENGINE_SCRATCH, Size(weightCols, weightRows), CV_32F, 1);
+	Mat integralImage = FrameWorkspace::Acquire(workspace, FrameWorkspace::ENGINE_SCRATCH, Size(differenceCols + 1, differenceRows + 1), CV_64F);
+
+	// Weighted sums of the three channels and the filter's norm
+	Mat accumulator = FrameWorkspace::Acquire(workspace, FrameWorkspace::ENGINE_SCRATCH, Size(cols, rows), CV_32FC4);
+	accumulator.setTo(Scalar::all(0));
+
+	for (int dy = (symmetric ? 0 : -padding); dy <= padding; dy++) {
+		for (int dx = -padding; dx <= padding; dx++) {
+			// The mirror of these offsets is visited with the positive ones
+			if (symmetric && dy == 0 && dx < 0) continue;
+
+			#pragma omp parallel for shared(weightingChannels, differences)
+			for (int y = 0; y < differenceRows; y++) {
+				const float *fixedL = weightingChannels[L].ptr<float>(origin + y) + origin;
+				const float *fixedA = weightingChannels[a].ptr<float>(origin + y) + origin;
+				const float *fixedB = weightingChannels[b].ptr<float>(origin + y) + origin;
+				const float *shiftedL = weightingChannels[L].ptr<float>(origin + y + dy) + origin + dx;
+				const float *shiftedA = weightingChannels[a].ptr<float>(origin + y + dy) + origin + dx;
+				const float *shiftedB = weightingChannels[b].ptr<float>(origin + y + dy) + origin + dx;
+				float *differenceRow = differences.ptr<float>(y);
+				for (int x = 0; x < differenceCols; x++) {
+					float dL = fixedL[x] - shiftedL[x], dA = fixedA[x] - shiftedA[x], dB = fixedB[x] - shiftedB[x];
+					differenceRow[x] = dL * dL + dA * dA + dB * dB;
+				}
+			}
+
+			// Double precision keeps the four lookups exact enough for large images
+			integral(differences, integralImage, CV_64F);
+
+			#pragma omp parallel for shared(integralImage, weights)
+			for (int y = 0; y < weightRows; y++) {
+				const double *top = integralImage.ptr<double>(y);
+				const double *bottom = integralImage.ptr<double>(y + neighborhoodSize);
+				float *weightRow = weights.ptr<float>(y);
+				for (int x = 0; x < weightCols; x++) {
+					double patchDistance = bottom[x + neighborhoodSize] - bottom[x] - top[x + neighborhoodSize] + top[x];
+					float distance = (float) (patchDistance / neighborhoodSize);
+					weightRow[x] = weightLUT ? (*weightLUT)(distance) : std::exp(weightFactor * (distance - weightOffset));
+				}
+			}
+
+			// The mirrored pair of a pixel is the one of the pixel at -o
+			const bool mirrored = symmetric && (dy != 0 || dx != 0);
+			#pragma omp parallel for shared(weights, inputChannels, accumulator)
+			for (int i = 0; i < rows; i++) {
+				const float *weightRow = weights.ptr<float>(i + extension) + extension;
+				const float *mirroredRow = mirrored ? weights.ptr<float>(i + extension - dy) + extension - dx : nullptr;
+				const float *iL = inputChannels[L].ptr<float>(border + i + dy) + border + dx;
+				const float *iA = inputChannels[a].ptr<float>(border + i + dy) + border + dx;
+				const float *iB = inputChannels[b].ptr<float>(border + i + dy) + border + dx;
+				const float *mL = inputChannels[L].ptr<float>(border + i - dy) + border - dx;
+				const float *mA = inputChannels[a].ptr<float>(border + i - dy) + border - dx;
+				const float *mB = inputChannels[b].ptr<float>(border + i - dy) + border - dx;
+				Vec4f *accumulatorRow = accumulator.ptr<Vec4f>(i);
+				for (int j = 0; j < cols; j++) {
+					float weight = weightRow[j];
+					accumulatorRow[j][0] += weight * iL[j];
+					accumulatorRow[j][1] += weight * iA[j];
+					accumulatorRow[j][2] += weight * iB[j];
+					accumulatorRow[j][3] += weight;
+					if (mirrored) {
+						weight = mirroredRow[j];
+						accumulatorRow[j][0] += weight * mL[j];
+						accumulatorRow[j][1] += weight * mA[j];
+						accumulatorRow[j][2] += weight * mB[j];
+						accumulatorRow[j][3] += weight;
+					}
+				}
+			}
+		}
+	}
+
+	// Normalize by the filter's norm
+	LabImage outputImage = FrameWorkspace::AcquireLab(workspace, FrameWorkspace::FILTERED_IMAGE, Size(cols, rows));
+	#pragma omp parallel for shared(accumulator, outputImage)
+	for (int i = 0; i < rows; i++) {
+		const Vec4f *accumulatorRow = accumulator.ptr<Vec4f>(i);
+		for (int channel = L; channel <= b; channel++) {
+			float *outputRow = outputImage.planes[channel].ptr<float>(i);
+			for (int j = 0; j < cols; j++) outputRow[j] = accumulatorRow[j][channel] / accumulatorRow[j][3];
 		}
 	}
 
-	// Discard the padding
-	xRange = Range(padding, inputImage.rows - padding);
-	yRange = Range(padding, inputImage.cols - padding);
-	return outputImage(xRange, yRange);
+	return outputImage;
 }
 
 /**
@@ -268,7 +1018,7 @@ Mat Filters::NonLocalMeansFilter(const Mat &inputImage_, const Mat &weightingIma
  * @param rangeSigma range or radiometric standard deviation. Used to calculate \f$ \epsilon = \sigma_r^2 \f$
  * @return Mat
  */
-Mat Filters::GuidedFilter(const Mat &inputImage, const Mat &guidingImage, int windowSize, double rangeSigma) {
+LabImage Filters::GuidedFilter(const LabImage &inputImage, const LabImage &guidingImage, int windowSize, double rangeSigma) {
 	/**
 	 * The Guided Filter initialy has the same form as any WAF
 	 * \f[ q_i = \sum_j W_{ij}(I)p_j \f]
@@ -289,10 +1039,15 @@ Mat Filters::GuidedFilter(const Mat &inputImage, const Mat &guidingImage, int wi
 	 * \f$ \frac{1}{|\omega|} \sum_{i\in \omega_k} p_i \f$ is the mean of \f$p\f$ in \f$ \omega_k \f$.
 	 * Finally the output of the filter is
 	 * \f[ q_i = \frac{1}{|\omega|} \sum_{k:i \in \omega_k} (a_k I_i + b_k )\f]
+	 * The mean coefficients vary smoothly for large windows, so with a subsampling factor \f$ s > 1 \f$ they are
+	 * computed on the images subsampled by \f$ s \f$ and bilinearly upsampled before being applied to the full
+	 * resolution guide (Fast Guided Filter). The filter reads the planes of both images and writes the output planes
 	 */
 
 	int widowRadius = windowSize / 2;
 	double epsilon = rangeSigma; //pow((rangeSigma), 2.0);
 
-	return guidedFilter(guidingImage, inputImage, widowRadius, epsilon, -1);
-}
\ No newline at end of file
+	LabImage outputImage = FrameWorkspace::AcquireLab(workspace, FrameWorkspace::FILTERED_IMAGE, inputImage.ImageSize());
+	guidedFilter(guidingImage.planes, inputImage.planes, outputImage.planes, widowRadius, epsilon, guidedSubsampling, workspace);
+	return outputImage;
+}
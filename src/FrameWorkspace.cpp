@@ -0,0 +1,153 @@
+#include "FrameWorkspace.hpp"
+
+#include <omp.h>
+
+/**
+ * @brief FrameWorkspace class constructor. Starts without buffers
+ *
+ */
+FrameWorkspace::FrameWorkspace(): allocations(0), reuses(0) {}
+
+/**
+ * @brief Gets a buffer, allocating it the first time it is requested
+ *
+ * @param buffer stage that uses the buffer
+ * @param size buffer size
+ * @param type buffer type
+ * @param index buffer index within the stage
+ * @return Mat buffer shared with the workspace, its contents are undefined
+ */
+Mat FrameWorkspace::Get(Buffer buffer, Size size, int type, int index) {
+	const Key key(buffer, index, size.height, size.width, type);
+
+	std::lock_guard<std::mutex> lock(mutex);
+	auto found = buffers.find(key);
+	if (found != buffers.end()) {
+		reuses++;
+		return found->second;
+	}
+
+	allocations++;
+	return buffers.emplace(key, Mat(size, type)).first->second;
+}
+
+/**
+ * @brief Gets a buffer from a workspace, or a new image when there is none
+ *
+ * @param workspace workspace, can be null
+ * @param buffer stage that uses the buffer
+ * @param size buffer size
+ * @param type buffer type
+ * @param index buffer index within the stage
+ * @return Mat buffer, its contents are undefined
+ */
+Mat FrameWorkspace::Acquire(FrameWorkspace *workspace, Buffer buffer, Size size, int type, int index) {
+	return workspace ? workspace->Get(buffer, size, type, index) : Mat(size, type);
+}
+
+/**
+ * @brief Gets a buffer of the calling thread from a workspace, or a new image when there is none. Inside of an
+ * OpenMP parallel region every thread of the team gets its own buffer for the same index
+ *
+ * @param workspace workspace, can be null
+ * @param buffer stage that uses the buffer
+ * @param size buffer size
+ * @param type buffer type
+ * @param index buffer index within the stage and thread
+ * @return Mat buffer, its contents are undefined
+ */
+Mat FrameWorkspace::AcquireThread(FrameWorkspace *workspace, Buffer buffer, Size size, int type, int index) {
+	return Acquire(workspace, buffer, size, type, index * omp_get_num_threads() + omp_get_thread_num());
+}
+
+/**
+ * @brief Splits an image into planes taken from a workspace, the plane of channel c is the buffer of index c
+ *
+ * @param workspace workspace, can be null
+ * @param buffer stage that uses the planes
+ * @param image image to split
+ * @param planes one plane per channel of the image
+ */
+void FrameWorkspace::AcquirePlanes(FrameWorkspace *workspace, Buffer buffer, const Mat &image, Mat planes[]) {
+	for (int channel = 0; channel < image.channels(); channel++)
+		planes[channel] = Acquire(workspace, buffer, image.size(), image.depth(), channel);
+	split(image, planes);
+}
+
+/**
+ * @brief Gets a planar CIELab image from a workspace, or a new one when there is none. The planes of the image of
+ * index i are the padded buffers of indices 3i, 3i + 1 and 3i + 2
+ *
+ * @param workspace workspace, can be null
+ * @param buffer stage that uses the image
+ * @param size image size
+ * @param index image index within the stage
+ * @return LabImage image over the buffers, its values are undefined
+ */
+LabImage FrameWorkspace::AcquireLab(FrameWorkspace *workspace, Buffer buffer, Size size, int index) {
+	const Size paddedSize(LabImage::PaddedCols(size.width), size.height);
+	Mat buffers[3];
+	for (int c = 0; c < 3; c++) buffers[c] = Acquire(workspace, buffer, paddedSize, CV_32FC1, 3 * index + c);
+	return LabImage(buffers, size);
+}
+
+/**
+ * @brief Gets a planar CIELab image whose size changes from one call to the next, such as a crop. Its planes lie
+ * at the start of buffers kept for the capacity size, with the rows of the image size, so like the planes of a
+ * new image they do not see the rest of the buffers as their neighbours
+ *
+ * @param workspace workspace, can be null
+ * @param buffer stage that uses the image
+ * @param size image size, at most the capacity
+ * @param capacity largest image size of the stage
+ * @param index image index within the stage
+ * @return LabImage image over the buffers, its values are undefined
+ */
+LabImage FrameWorkspace::AcquireCrop(FrameWorkspace *workspace, Buffer buffer, Size size, Size capacity, int index) {
+	CV_Assert(size.width <= capacity.width && size.height <= capacity.height);
+	if (!workspace) return LabImage(size);
+
+	const Size paddedCapacity(LabImage::PaddedCols(capacity.width), capacity.height);
+	Mat buffers[3];
+	for (int c = 0; c < 3; c++) {
+		const Mat storage = workspace->Get(buffer, paddedCapacity, CV_32FC1, 3 * index + c);
+		buffers[c] = Mat(size.height, LabImage::PaddedCols(size.width), CV_32FC1, storage.data);
+	}
+	return LabImage(buffers, size);
+}
+
+/**
+ * @brief Gets the number of buffers allocated since the last counter reset
+ *
+ * @return unsigned long allocated buffers
+ */
+unsigned long FrameWorkspace::Allocations() const {
+	return allocations;
+}
+
+/**
+ * @brief Gets the number of buffers reused since the last counter reset
+ *
+ * @return unsigned long reused buffers
+ */
+unsigned long FrameWorkspace::Reuses() const {
+	return reuses;
+}
+
+/**
+ * @brief Resets the allocation and reuse counters, the buffers are kept
+ *
+ */
+void FrameWorkspace::ResetCounters() {
+	allocations = 0;
+	reuses = 0;
+}
+
+/**
+ * @brief Releases all the buffers
+ *
+ */
+void FrameWorkspace::Clear() {
+	std::lock_guard<std::mutex> lock(mutex);
+	buffers.clear();
+}
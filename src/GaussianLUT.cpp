@@ -0,0 +1,53 @@
+#include "GaussianLUT.hpp"
+
+#include <cmath>
+
+/**
+ * @brief GaussianLUT class constructor. The table is empty until it is built
+ *
+ */
+GaussianLUT::GaussianLUT(): factor(0.0f), offset(0.0f), scale(0.0f) {}
+
+/**
+ * @brief Tabulates \f$ w(d) = \exp(\alpha (d - \beta)) \f$ on \f$ N + 1 \f$ equally spaced distances. Two extra zero
+ * entries close the table so the interpolation never reads out of it
+ *
+ * @param factor exponent factor \f$ \alpha \f$, has to be negative
+ * @param offset distance offset \f$ \beta \f$
+ * @return true if the table was rebuilt
+ * @return false if it already held these parameters
+ */
+bool GaussianLUT::Build(float factor, float offset) {
+	if (!table.empty() && factor == this->factor && offset == this->offset) return false;
+	this->factor = factor;
+	this->offset = offset;
+
+	// Largest distance before the exponent falls below the cutoff
+	const double cutoff = 16.0;
+	double maxDistance = (double) offset + cutoff / -(double) factor;
+	scale = (float) (SIZE / maxDistance);
+
+	table.assign(SIZE + 2, 0.0f);
+	for (int i = 0; i < SIZE; i++)
+		table[(std::size_t) i] = (float) std::exp((double) factor * ((double) i / scale - (double) offset));
+
+	return true;
+}
+
+/**
+ * @brief Gets the table entries
+ *
+ * @return const float* \f$ N + 2 \f$ table entries
+ */
+const float *GaussianLUT::Table() const {
+	return table.data();
+}
+
+/**
+ * @brief Gets the scale that converts a distance into a table position
+ *
+ * @return float table entries per distance unit
+ */
+float GaussianLUT::Scale() const {
+	return scale;
+}
@@ -1,11 +1,24 @@
 #include "GuidedFilter.hpp"
 
-static cv::Mat boxfilter(const cv::Mat &I, int r) {
-	cv::Mat result;
+#include <vector>
+#include <functional>
+#include <algorithm>
+#include <omp.h>
+
+static void boxfilter(const cv::Mat &I, int r, cv::Mat &result) {
 	cv::blur(I, result, cv::Size(r, r), cv::Point(-1, -1), cv::BORDER_REPLICATE);
-	return result;
 }
 
+// Workspace indices of the guided filter buffers, the planes of an image take the indices of its channels
+static const int OUTPUT_PLANES = CV_CN_MAX;			// First output plane
+static const int RESAMPLED_IMAGE = 2 * CV_CN_MAX;	// Subsampled images and upsampled coefficients
+
+// Per thread workspace indices of the sweeps, a BoxMeans takes its index and the next one
+static const int MOMENT_SWEEP = 0;		// Guide moments
+static const int PRODUCT_SWEEP = 2;		// Input and guide products
+static const int COEFFICIENT_SWEEP = 4;	// Linear coefficients
+static const int SWEEP_ROWS = 6;		// First row of means or coefficients handed between the sweeps
+
 static cv::Mat convertTo(const cv::Mat &mat, int depth) {
 	if (mat.depth() == depth)
 		return mat;
@@ -15,42 +28,172 @@ static cv::Mat convertTo(const cv::Mat &mat, int depth) {
 	return result;
 }
 
+/**
+ * @brief Running box means with replicated borders, the same as cv::blur with BORDER_REPLICATE, over a range of
+ * rows. The source rows are produced on demand by a callback, each one once, and kept in a ring of window size
+ * rows. The column sums slide down one row per step and the row sums slide along the columns, both in double
+ * precision, so no full frame intermediate is needed for any of the channels. The ring and the column sums are
+ * buffers of the calling thread, taken from the workspace when there is one
+ *
+ */
+class BoxMeans {
+public:
+	typedef std::function<void(int row, float *values)> Source;
+
+	BoxMeans(int rows, int cols, int channels, int size, const Source &source, FrameWorkspace *workspace, int index);
+
+	void start(int row);
+	void next(float *means);
+
+private:
+	int rows, cols, channels, size, radius;
+	Source source;
+	cv::Mat ring;						// size source rows with their channels interleaved
+	cv::Mat columnSums;					// Column sums of the window rows
+	int row;							// Next output row
+	bool pending;						// The window has to slide before the next output row
+
+	int slot(int virtualRow) const { return ((virtualRow % size) + size) % size; }
+	int clampRow(int virtualRow) const { return std::min(std::max(virtualRow, 0), rows - 1); }
+};
+
+/**
+ * @brief Construct a new BoxMeans object
+ *
+ * @param rows rows of the source image
+ * @param cols columns of the source image
+ * @param channels interleaved channels of each source row
+ * @param size box size, odd
+ * @param source callback that writes the cols x channels values of a source row
+ * @param workspace buffers reused across frames, can be null
+ * @param index per thread workspace index of the ring, the column sums take the next one
+ */
+BoxMeans::BoxMeans(int rows, int cols, int channels, int size, const Source &source, FrameWorkspace *workspace, int index)
+	: rows(rows), cols(cols), channels(channels), size(size), radius(size / 2), source(source),
+	  ring(FrameWorkspace::AcquireThread(workspace, FrameWorkspace::THREAD_SCRATCH, cv::Size(cols * channels, size), CV_32F, index)),
+	  columnSums(FrameWorkspace::AcquireThread(workspace, FrameWorkspace::THREAD_SCRATCH, cv::Size(cols * channels, 1), CV_64F, index + 1)),
+	  row(0), pending(false) {
+	CV_Assert(size % 2 == 1);
+}
+
+/**
+ * @brief Fills the window of an output row, the following ones are reached through next
+ *
+ * @param firstRow first output row
+ */
+void BoxMeans::start(int firstRow) {
+	const int width = cols * channels;
+	double *sums = columnSums.ptr<double>();
+	std::fill(sums, sums + width, 0.0);
+	for (int k = firstRow - radius; k <= firstRow + radius; k++) {
+		float *values = ring.ptr<float>(slot(k));
+		source(clampRow(k), values);
+		for (int j = 0; j < width; j++) sums[j] += values[j];
+	}
+	row = firstRow;
+	pending = false;
+}
+
+/**
+ * @brief Computes the box means of the next output row
+ *
+ * @param means cols x channels output values
+ */
+void BoxMeans::next(float *means) {
+	const int width = cols * channels;
+	double *sums = columnSums.ptr<double>();
+	if (pending) {
+		// The leaving and the entering rows share the ring slot
+		float *values = ring.ptr<float>(slot(row - radius - 1));
+		for (int j = 0; j < width; j++) sums[j] -= values[j];
+		source(clampRow(row + radius), values);
+		for (int j = 0; j < width; j++) sums[j] += values[j];
+	}
+
+	const double norm = 1.0 / ((double) size * (double) size);
+	for (int c = 0; c < channels; c++) {
+		double sum = 0.0;
+		for (int m = -radius; m <= radius; m++)
+			sum += sums[std::min(std::max(m, 0), cols - 1) * channels + c];
+		for (int j = 0; j < cols; j++) {
+			means[j * channels + c] = (float) (sum * norm);
+			sum += sums[std::min(j + radius + 1, cols - 1) * channels + c]
+				 - sums[std::max(j - radius, 0) * channels + c];
+		}
+	}
+
+	row++;
+	pending = true;
+}
+
+/**
+ * @brief Base of the guided filter implementations. The channels of the input are split in row bands and every
+ * channel and band pair runs as an OpenMP task, each band reads the halo it needs from the neighbouring rows
+ *
+ */
 class GuidedFilterImpl {
 public:
+	GuidedFilterImpl(int r, int Icn, FrameWorkspace *workspace) : r(r), Icn(Icn), workspace(workspace), s(1) {}
 	virtual ~GuidedFilterImpl() {}
 
 	cv::Mat filter(const cv::Mat &p, int depth);
+	void filter(const cv::Mat *p, int channels, cv::Mat *q);
+	void subsample(const cv::Mat &fullI, int s);
+	void subsample(const cv::Mat *fullI, int channels, int s);
 
 protected:
+	static const int MIN_BAND_ROWS = 32;	// Smallest band worth its halo
+
+	int r;			// Box size
+	int Icn;		// Guide channels
 	int Idepth;
+	FrameWorkspace *workspace;	// Buffers reused across frames, can be null
+
+	int bandCount(int rows, int channels) const;
 
 private:
-	virtual cv::Mat filterSingleChannel(const cv::Mat &p) const = 0;
+	int s;
+	std::vector<cv::Mat> fullIchannels;
+
+	void applyCoefficients(const cv::Mat &meanCoefficients, cv::Mat &q) const;
+
+	virtual void filterRows(const cv::Mat &p, int rowBegin, int rowEnd, cv::Mat &q) const = 0;
+	virtual void coefficientRows(const cv::Mat &p, int rowBegin, int rowEnd, cv::Mat &meanCoefficients) const = 0;
 };
 
 class GuidedFilterMono : public GuidedFilterImpl {
 public:
-	GuidedFilterMono(const cv::Mat &I, int r, double eps);
+	GuidedFilterMono(const cv::Mat &I, int r, double eps, FrameWorkspace *workspace);
 
 private:
-	virtual cv::Mat filterSingleChannel(const cv::Mat &p) const;
+	virtual void filterRows(const cv::Mat &p, int rowBegin, int rowEnd, cv::Mat &q) const;
+	virtual void coefficientRows(const cv::Mat &p, int rowBegin, int rowEnd, cv::Mat &meanCoefficients) const;
+	void bandCoefficients(const cv::Mat &p, const cv::Range &band, cv::Mat &mean_a, cv::Mat &mean_b) const;
 
 private:
-	int r;
 	double eps;
 	cv::Mat I, mean_I, var_I;
 };
 
+/**
+ * @brief Color guided filter. The box means of the guide moments and of the input products are computed in fused
+ * sweeps with running sums (see BoxMeans), the linear coefficients of a row are produced right when the second
+ * box filter needs them, so each channel reads its input once and writes its output once
+ *
+ */
 class GuidedFilterColor : public GuidedFilterImpl {
 public:
-	GuidedFilterColor(const cv::Mat &I, int r, double eps);
+	GuidedFilterColor(const cv::Mat &I, int r, double eps, FrameWorkspace *workspace);
+	GuidedFilterColor(const cv::Mat *Iplanes, int r, double eps, FrameWorkspace *workspace);
 
 private:
-	virtual cv::Mat filterSingleChannel(const cv::Mat &p) const;
+	void initGuide();
+	virtual void filterRows(const cv::Mat &p, int rowBegin, int rowEnd, cv::Mat &q) const;
+	virtual void coefficientRows(const cv::Mat &p, int rowBegin, int rowEnd, cv::Mat &meanCoefficients) const;
+	void sweepRows(const cv::Mat &p, int rowBegin, int rowEnd, const std::function<void(int row, const float *meanCoefficients)> &apply) const;
 
 private:
 	std::vector<cv::Mat> Ichannels;
-	int r;
 	double eps;
 	cv::Mat mean_I_r, mean_I_g, mean_I_b;
 	cv::Mat invrr, invrg, invrb, invgg, invgb, invbb;
@@ -60,117 +203,405 @@ private:
 cv::Mat GuidedFilterImpl::filter(const cv::Mat &p, int depth) {
 	cv::Mat p2 = convertTo(p, Idepth);
 
+	const int channels = p2.channels();
+	std::vector<cv::Mat> pc((std::size_t) channels), qc((std::size_t) channels);
+	FrameWorkspace::AcquirePlanes(workspace, FrameWorkspace::GUIDED_PLANES, p2, pc.data());
+	for (int c = 0; c < channels; c++)
+		qc[(std::size_t) c] = FrameWorkspace::Acquire(workspace, FrameWorkspace::GUIDED_PLANES, p2.size(), s > 1 ? CV_32F : Idepth, OUTPUT_PLANES + c);
+	filter(pc.data(), channels, qc.data());
+
 	cv::Mat result;
-	if (p.channels() == 1) {
-		result = filterSingleChannel(p2);
-	}
+	if (channels == 1) result = qc[0];
 	else {
-		std::vector<cv::Mat> pc;
-		cv::split(p2, pc);
-
-		for (std::size_t i = 0; i < pc.size(); ++i)
-			pc[i] = filterSingleChannel(pc[i]);
-
-		cv::merge(pc, result);
+		result = FrameWorkspace::Acquire(workspace, FrameWorkspace::FILTERED_IMAGE, qc[0].size(), CV_MAKETYPE(qc[0].depth(), channels));
+		cv::merge(qc, result);
 	}
 
 	return convertTo(result, depth == -1 ? p.depth() : depth);
 }
 
-GuidedFilterMono::GuidedFilterMono(const cv::Mat &origI, int r, double eps) : r(r), eps(eps) {
-	if (origI.depth() == CV_32F || origI.depth() == CV_64F)
-		I = origI.clone();
-	else
-		I = convertTo(origI, CV_32F);
+/**
+ * @brief Filters the planes of an image into the planes of the output, without splitting or merging them
+ *
+ * @param p input planes of the guide depth
+ * @param channels number of input planes
+ * @param q output planes, the same size as the input planes
+ */
+void GuidedFilterImpl::filter(const cv::Mat *p, int channels, cv::Mat *q) {
+	for (int c = 0; c < channels; c++) CV_Assert(p[c].type() == Idepth && q[c].size() == p[c].size());
+
+	// The coefficients are computed on the subsampled input and applied to the full resolution guide
+	std::vector<cv::Mat> pc(p, p + channels);
+	if (s > 1) {
+		CV_Assert(p[0].size() == fullIchannels[0].size());
+		const cv::Size smallSize((p[0].cols + s - 1) / s, (p[0].rows + s - 1) / s);
+		for (int c = 0; c < channels; c++) {
+			pc[(std::size_t) c] = FrameWorkspace::Acquire(workspace, FrameWorkspace::GUIDED_PLANES, smallSize, Idepth, RESAMPLED_IMAGE + c);
+			cv::resize(p[c], pc[(std::size_t) c], smallSize, 0, 0, cv::INTER_AREA);
+		}
+	}
 
-	Idepth = I.depth();
+	// Outputs of every channel, or their mean coefficients for the fast filter
+	std::vector<cv::Mat> qc(q, q + channels);
+	if (s > 1)
+		for (int c = 0; c < channels; c++)
+			qc[(std::size_t) c] = FrameWorkspace::Acquire(workspace, FrameWorkspace::GUIDED_PLANES, pc[0].size(), CV_MAKETYPE(Idepth, Icn + 1), OUTPUT_PLANES + c);
+
+	// Every channel and row band pair is an independent task. The tasks are alike, and the static schedule hands the
+	// same ones to every thread on every frame, so the per thread buffers of the workspace are the same
+	const int rows = pc[0].rows;
+	const int bands = bandCount(rows, channels);
+	const int bandRows = (rows + bands - 1) / bands;
+	#pragma omp parallel for collapse(2) schedule(static) shared(pc, qc)
+	for (int c = 0; c < channels; c++) {
+		for (int band = 0; band < bands; band++) {
+			const int rowBegin = std::min(band * bandRows, rows), rowEnd = std::min(rowBegin + bandRows, rows);
+			if (rowBegin == rowEnd) continue;
+			if (s > 1) coefficientRows(pc[(std::size_t) c], rowBegin, rowEnd, qc[(std::size_t) c]);
+			else filterRows(pc[(std::size_t) c], rowBegin, rowEnd, qc[(std::size_t) c]);
+		}
+	}
 
-	mean_I = boxfilter(I, r);
-	cv::Mat mean_II = boxfilter(I.mul(I), r);
-	var_I = mean_II - mean_I.mul(mean_I);
+	if (s > 1)
+		for (int c = 0; c < channels; c++) applyCoefficients(qc[(std::size_t) c], q[c]);
 }
 
-cv::Mat GuidedFilterMono::filterSingleChannel(const cv::Mat &p) const {
-	cv::Mat mean_p = boxfilter(p, r);
-	cv::Mat mean_Ip = boxfilter(I.mul(p), r);
-	cv::Mat cov_Ip = mean_Ip - mean_I.mul(mean_p); // this is the covariance of (I, p) in each local patch.
+/**
+ * @brief Gets the number of row bands per channel. There are enough bands to keep every thread busy, as long as
+ * they are tall enough for their halo not to dominate
+ *
+ * @param rows rows of the filtered image
+ * @param channels channels filtered at the same time
+ * @return int number of row bands
+ */
+int GuidedFilterImpl::bandCount(int rows, int channels) const {
+	const int threads = omp_get_max_threads();
+	const int tallestBands = std::max(1, rows / std::max(MIN_BAND_ROWS, 2 * r));
+	return std::max(1, std::min((threads + channels - 1) / channels, tallestBands));
+}
 
-	cv::Mat a = cov_Ip / (var_I + eps); // Eqn. (5) in the paper;
-	cv::Mat b = mean_p - a.mul(mean_I); // Eqn. (6) in the paper;
+/**
+ * @brief Turns the filter into a Fast Guided Filter (K. He and J. Sun, 2015). The filter has to be built on the
+ * guide subsampled by s, its mean linear coefficients are then upsampled and applied to the full resolution guide
+ *
+ * @param fullI full resolution guide
+ * @param s subsampling factor
+ */
+void GuidedFilterImpl::subsample(const cv::Mat &fullI, int s) {
+	this->s = s;
+	const cv::Mat guide = convertTo(fullI, CV_32F);
+	fullIchannels.resize((std::size_t) guide.channels());
+	FrameWorkspace::AcquirePlanes(workspace, FrameWorkspace::GUIDE_PLANES, guide, fullIchannels.data());
+}
 
-	cv::Mat mean_a = boxfilter(a, r);
-	cv::Mat mean_b = boxfilter(b, r);
+/**
+ * @brief Turns the filter into a Fast Guided Filter with a planar full resolution guide, which is used in place
+ *
+ * @param fullI CV_32F planes of the full resolution guide
+ * @param channels number of guide planes
+ * @param s subsampling factor
+ */
+void GuidedFilterImpl::subsample(const cv::Mat *fullI, int channels, int s) {
+	this->s = s;
+	for (int c = 0; c < channels; c++) CV_Assert(fullI[c].type() == CV_32F);
+	fullIchannels.assign(fullI, fullI + channels);
+}
 
-	return mean_a.mul(I) + mean_b;
+/**
+ * @brief Applies the mean linear coefficients of a subsampled channel to the full resolution guide, Eqn. (16)
+ * in the paper with bilinearly upsampled coefficients
+ *
+ * @param meanCoefficients mean coefficients a of each guide channel followed by the mean coefficient b
+ * @param q full resolution single precision output channel
+ */
+void GuidedFilterImpl::applyCoefficients(const cv::Mat &meanCoefficients, cv::Mat &q) const {
+	const int guideChannels = (int) fullIchannels.size();
+	const int channels = guideChannels + 1;
+	CV_Assert(meanCoefficients.channels() == channels);
+
+	const cv::Size fullSize = fullIchannels[0].size();
+	cv::Mat upsampled = FrameWorkspace::Acquire(workspace, FrameWorkspace::GUIDED_PLANES, fullSize, CV_MAKETYPE(CV_32F, channels), RESAMPLED_IMAGE);
+	cv::resize(convertTo(meanCoefficients, CV_32F), upsampled, fullSize, 0, 0, cv::INTER_LINEAR);
+
+	CV_Assert(q.type() == CV_32F && q.size() == fullSize);
+	#pragma omp parallel for shared(upsampled, q)
+	for (int i = 0; i < q.rows; i++) {
+		const float *m = upsampled.ptr<float>(i);
+		float *qRow = q.ptr<float>(i);
+		for (int j = 0; j < q.cols; j++, m += channels) {
+			float value = m[guideChannels];
+			for (int k = 0; k < guideChannels; k++) value += m[k] * fullIchannels[(std::size_t) k].ptr<float>(i)[j];
+			qRow[j] = value;
+		}
+	}
 }
 
-GuidedFilterColor::GuidedFilterColor(const cv::Mat &origI, int r, double eps) : r(r), eps(eps) {
-	cv::Mat I;
-	if (origI.depth() == CV_32F || origI.depth() == CV_64F)
-		I = origI.clone();
-	else
-		I = convertTo(origI, CV_32F);
+GuidedFilterMono::GuidedFilterMono(const cv::Mat &origI, int r, double eps, FrameWorkspace *workspace) : GuidedFilterImpl(r, 1, workspace), eps(eps) {
+	Idepth = origI.depth() == CV_64F ? CV_64F : CV_32F;
+	I = FrameWorkspace::Acquire(workspace, FrameWorkspace::GUIDE_PLANES, origI.size(), Idepth);
+	origI.convertTo(I, Idepth);
+
+	// The guide moments and their scratch images are kept in the workspace
+	cv::Mat moments[4];
+	for (int k = 0; k < 4; k++) moments[k] = FrameWorkspace::Acquire(workspace, FrameWorkspace::GUIDE_MOMENTS, I.size(), Idepth, k);
+	mean_I = moments[0];
+	var_I = moments[1];
+	cv::Mat mean_II = moments[2], product = moments[3];
+
+	boxfilter(I, r, mean_I);
+	cv::multiply(I, I, product);
+	boxfilter(product, r, mean_II);
+	cv::multiply(mean_I, mean_I, product);
+	cv::subtract(mean_II, product, var_I);
+}
 
-	Idepth = I.depth();
+/**
+ * @brief Computes the mean coefficients of a band of rows. The two stacked box filters reach r - 1 rows away, so
+ * the band is extended by that halo and the replicated border of the extension never reaches the band rows.
+ * The intermediate images of the extended band are buffers of the calling thread, the mean coefficients are views
+ * of two of them
+ *
+ * @param p input channel
+ * @param band rows of the band
+ * @param mean_a mean coefficient a of the band rows
+ * @param mean_b mean coefficient b of the band rows
+ */
+void GuidedFilterMono::bandCoefficients(const cv::Mat &p, const cv::Range &band, cv::Mat &mean_a, cv::Mat &mean_b) const {
+	const cv::Range extended(std::max(band.start - (r - 1), 0), std::min(band.end + r - 1, p.rows));
+	const cv::Mat bandI = I.rowRange(extended), bandMean_I = mean_I.rowRange(extended), bandVar_I = var_I.rowRange(extended);
+	const cv::Mat bandP = p.rowRange(extended);
+
+	cv::Mat scratch[5];
+	for (int k = 0; k < 5; k++) scratch[k] = FrameWorkspace::AcquireThread(workspace, FrameWorkspace::THREAD_SCRATCH, bandP.size(), Idepth, k);
+	cv::Mat mean_p = scratch[0], mean_Ip = scratch[1], product = scratch[2], a = scratch[3], b = scratch[4];
+
+	boxfilter(bandP, r, mean_p);
+	cv::multiply(bandI, bandP, product);
+	boxfilter(product, r, mean_Ip);
+	cv::multiply(bandMean_I, mean_p, product);
+	cv::Mat cov_Ip = mean_Ip; // this is the covariance of (I, p) in each local patch, computed in place.
+	cv::subtract(mean_Ip, product, cov_Ip);
+
+	cv::add(bandVar_I, cv::Scalar::all(eps), product);
+	cv::divide(cov_Ip, product, a); // Eqn. (5) in the paper;
+	cv::multiply(a, bandMean_I, product);
+	cv::subtract(mean_p, product, b); // Eqn. (6) in the paper;
+
+	// The box means of the coefficients replace the images that are no longer needed
+	const cv::Range inside(band.start - extended.start, band.end - extended.start);
+	boxfilter(a, r, mean_Ip);
+	boxfilter(b, r, mean_p);
+	mean_a = mean_Ip.rowRange(inside);
+	mean_b = mean_p.rowRange(inside);
+}
+
+void GuidedFilterMono::filterRows(const cv::Mat &p, int rowBegin, int rowEnd, cv::Mat &q) const {
+	cv::Mat mean_a, mean_b;
+	bandCoefficients(p, cv::Range(rowBegin, rowEnd), mean_a, mean_b);
 
-	cv::split(I, Ichannels);
+	cv::Mat band = q.rowRange(rowBegin, rowEnd);
+	cv::multiply(mean_a, I.rowRange(rowBegin, rowEnd), band);
+	cv::add(band, mean_b, band);
+}
 
-	mean_I_r = boxfilter(Ichannels[0], r);
-	mean_I_g = boxfilter(Ichannels[1], r);
-	mean_I_b = boxfilter(Ichannels[2], r);
+void GuidedFilterMono::coefficientRows(const cv::Mat &p, int rowBegin, int rowEnd, cv::Mat &meanCoefficients) const {
+	cv::Mat mean_a, mean_b;
+	bandCoefficients(p, cv::Range(rowBegin, rowEnd), mean_a, mean_b);
 
-	// variance of I in each local patch: the matrix Sigma in Eqn (14).
-	// Note the variance in each local patch is a 3x3 symmetric matrix:
-	//           rr, rg, rb
-	//   Sigma = rg, gg, gb
-	//           rb, gb, bb
-	cv::Mat var_I_rr = boxfilter(Ichannels[0].mul(Ichannels[0]), r) - mean_I_r.mul(mean_I_r) + eps;
-	cv::Mat var_I_rg = boxfilter(Ichannels[0].mul(Ichannels[1]), r) - mean_I_r.mul(mean_I_g);
-	cv::Mat var_I_rb = boxfilter(Ichannels[0].mul(Ichannels[2]), r) - mean_I_r.mul(mean_I_b);
-	cv::Mat var_I_gg = boxfilter(Ichannels[1].mul(Ichannels[1]), r) - mean_I_g.mul(mean_I_g) + eps;
-	cv::Mat var_I_gb = boxfilter(Ichannels[1].mul(Ichannels[2]), r) - mean_I_g.mul(mean_I_b);
-	cv::Mat var_I_bb = boxfilter(Ichannels[2].mul(Ichannels[2]), r) - mean_I_b.mul(mean_I_b) + eps;
+	cv::Mat band = meanCoefficients.rowRange(rowBegin, rowEnd);
+	const cv::Mat coefficients[] = {mean_a, mean_b};
+	cv::merge(coefficients, 2, band);
+}
 
-	// Inverse of Sigma + eps * I
-	invrr = var_I_gg.mul(var_I_bb) - var_I_gb.mul(var_I_gb);
-	invrg = var_I_gb.mul(var_I_rb) - var_I_rg.mul(var_I_bb);
-	invrb = var_I_rg.mul(var_I_gb) - var_I_gg.mul(var_I_rb);
-	invgg = var_I_rr.mul(var_I_bb) - var_I_rb.mul(var_I_rb);
-	invgb = var_I_rb.mul(var_I_rg) - var_I_rr.mul(var_I_gb);
-	invbb = var_I_rr.mul(var_I_gg) - var_I_rg.mul(var_I_rg);
+GuidedFilterColor::GuidedFilterColor(const cv::Mat &origI, int r, double eps, FrameWorkspace *workspace) : GuidedFilterImpl(r, 3, workspace), eps(eps) {
+	// The fused sweeps run in single precision
+	cv::Mat I = convertTo(origI, CV_32F);
 
-	cv::Mat covDet = invrr.mul(var_I_rr) + invrg.mul(var_I_rg) + invrb.mul(var_I_rb);
+	Idepth = I.depth();
 
-	invrr /= covDet;
-	invrg /= covDet;
-	invrb /= covDet;
-	invgg /= covDet;
-	invgb /= covDet;
-	invbb /= covDet;
+	Ichannels.resize(3);
+	FrameWorkspace::AcquirePlanes(workspace, FrameWorkspace::GUIDE_PLANES, I, Ichannels.data());
+	initGuide();
 }
 
-cv::Mat GuidedFilterColor::filterSingleChannel(const cv::Mat &p) const {
-	cv::Mat mean_p = boxfilter(p, r);
+/**
+ * @brief Construct a color guided filter over the planes of the guide, which are read in place
+ *
+ * @param Iplanes CV_32F planes of the guide
+ * @param r box size
+ * @param eps epsilon value
+ * @param workspace buffers reused across frames, can be null
+ */
+GuidedFilterColor::GuidedFilterColor(const cv::Mat *Iplanes, int r, double eps, FrameWorkspace *workspace) : GuidedFilterImpl(r, 3, workspace), eps(eps) {
+	for (int c = 0; c < 3; c++) CV_Assert(Iplanes[c].type() == CV_32F && Iplanes[c].size() == Iplanes[0].size());
 
-	cv::Mat mean_Ip_r = boxfilter(Ichannels[0].mul(p), r);
-	cv::Mat mean_Ip_g = boxfilter(Ichannels[1].mul(p), r);
-	cv::Mat mean_Ip_b = boxfilter(Ichannels[2].mul(p), r);
+	Idepth = CV_32F;
 
-	// covariance of (I, p) in each local patch.
-	cv::Mat cov_Ip_r = mean_Ip_r - mean_I_r.mul(mean_p);
-	cv::Mat cov_Ip_g = mean_Ip_g - mean_I_g.mul(mean_p);
-	cv::Mat cov_Ip_b = mean_Ip_b - mean_I_b.mul(mean_p);
+	Ichannels.assign(Iplanes, Iplanes + 3);
+	initGuide();
+}
+
+/**
+ * @brief Computes the box means of the guide and the inverses of its regularized covariances
+ *
+ */
+void GuidedFilterColor::initGuide() {
+	const int rows = Ichannels[0].rows, cols = Ichannels[0].cols;
+	cv::Mat *moments[] = {&mean_I_r, &mean_I_g, &mean_I_b, &invrr, &invrg, &invrb, &invgg, &invgb, &invbb};
+	for (int k = 0; k < 9; k++)
+		*moments[k] = FrameWorkspace::Acquire(workspace, FrameWorkspace::GUIDE_MOMENTS, Ichannels[0].size(), CV_32F, k);
+
+	// First and second moments of the guide: r, g, b, rr, rg, rb, gg, gb, bb
+	const auto guideMoments = [this, cols](int row, float *values) {
+		const float *Ir = Ichannels[0].ptr<float>(row), *Ig = Ichannels[1].ptr<float>(row), *Ib = Ichannels[2].ptr<float>(row);
+		for (int j = 0; j < cols; j++, values += 9) {
+			values[0] = Ir[j];
+			values[1] = Ig[j];
+			values[2] = Ib[j];
+			values[3] = Ir[j] * Ir[j];
+			values[4] = Ir[j] * Ig[j];
+			values[5] = Ir[j] * Ib[j];
+			values[6] = Ig[j] * Ig[j];
+			values[7] = Ig[j] * Ib[j];
+			values[8] = Ib[j] * Ib[j];
+		}
+	};
+
+	// Each row band sweeps its own window, statically scheduled for the per thread buffers as in filter
+	const float e = (float) eps;
+	const int bands = bandCount(rows, 1);
+	const int bandRows = (rows + bands - 1) / bands;
+	#pragma omp parallel for schedule(static)
+	for (int band = 0; band < bands; band++) {
+		const int rowBegin = std::min(band * bandRows, rows), rowEnd = std::min(rowBegin + bandRows, rows);
+		if (rowBegin == rowEnd) continue;
+		BoxMeans moments(rows, cols, 9, r, guideMoments, workspace, MOMENT_SWEEP);
+		cv::Mat meanRow = FrameWorkspace::AcquireThread(workspace, FrameWorkspace::THREAD_SCRATCH, cv::Size(cols * 9, 1), CV_32F, SWEEP_ROWS);
+		float *means = meanRow.ptr<float>();
+		moments.start(rowBegin);
+		for (int i = rowBegin; i < rowEnd; i++) {
+			moments.next(means);
+			float *mr = mean_I_r.ptr<float>(i), *mg = mean_I_g.ptr<float>(i), *mb = mean_I_b.ptr<float>(i);
+			float *rr = invrr.ptr<float>(i), *rg = invrg.ptr<float>(i), *rb = invrb.ptr<float>(i);
+			float *gg = invgg.ptr<float>(i), *gb = invgb.ptr<float>(i), *bb = invbb.ptr<float>(i);
+			for (int j = 0; j < cols; j++) {
+				const float *m = &means[j * 9];
+				mr[j] = m[0];
+				mg[j] = m[1];
+				mb[j] = m[2];
+
+				// variance of I in each local patch: the matrix Sigma in Eqn (14).
+				// Note the variance in each local patch is a 3x3 symmetric matrix:
+				//           rr, rg, rb
+				//   Sigma = rg, gg, gb
+				//           rb, gb, bb
+				const float var_I_rr = m[3] - m[0] * m[0] + e;
+				const float var_I_rg = m[4] - m[0] * m[1];
+				const float var_I_rb = m[5] - m[0] * m[2];
+				const float var_I_gg = m[6] - m[1] * m[1] + e;
+				const float var_I_gb = m[7] - m[1] * m[2];
+				const float var_I_bb = m[8] - m[2] * m[2] + e;
+
+				// Inverse of Sigma + eps * I
+				rr[j] = var_I_gg * var_I_bb - var_I_gb * var_I_gb;
+				rg[j] = var_I_gb * var_I_rb - var_I_rg * var_I_bb;
+				rb[j] = var_I_rg * var_I_gb - var_I_gg * var_I_rb;
+				gg[j] = var_I_rr * var_I_bb - var_I_rb * var_I_rb;
+				gb[j] = var_I_rb * var_I_rg - var_I_rr * var_I_gb;
+				bb[j] = var_I_rr * var_I_gg - var_I_rg * var_I_rg;
+
+				const float covDet = rr[j] * var_I_rr + rg[j] * var_I_rg + rb[j] * var_I_rb;
+
+				rr[j] /= covDet;
+				rg[j] /= covDet;
+				rb[j] /= covDet;
+				gg[j] /= covDet;
+				gb[j] /= covDet;
+				bb[j] /= covDet;
+			}
+		}
+	}
+}
 
-	cv::Mat a_r = invrr.mul(cov_Ip_r) + invrg.mul(cov_Ip_g) + invrb.mul(cov_Ip_b);
-	cv::Mat a_g = invrg.mul(cov_Ip_r) + invgg.mul(cov_Ip_g) + invgb.mul(cov_Ip_b);
-	cv::Mat a_b = invrb.mul(cov_Ip_r) + invgb.mul(cov_Ip_g) + invbb.mul(cov_Ip_b);
+void GuidedFilterColor::filterRows(const cv::Mat &p, int rowBegin, int rowEnd, cv::Mat &q) const {
+	sweepRows(p, rowBegin, rowEnd, [this, &q](int i, const float *m) {
+		const float *Ir = Ichannels[0].ptr<float>(i), *Ig = Ichannels[1].ptr<float>(i), *Ib = Ichannels[2].ptr<float>(i);
+		float *qRow = q.ptr<float>(i);
+		for (int j = 0; j < q.cols; j++, m += 4)
+			qRow[j] = m[0] * Ir[j] + m[1] * Ig[j] + m[2] * Ib[j] + m[3]; // Eqn. (16) in the paper;
+	});
+}
 
-	cv::Mat b = mean_p - a_r.mul(mean_I_r) - a_g.mul(mean_I_g) - a_b.mul(mean_I_b); // Eqn. (15) in the paper;
+void GuidedFilterColor::coefficientRows(const cv::Mat &p, int rowBegin, int rowEnd, cv::Mat &meanCoefficients) const {
+	sweepRows(p, rowBegin, rowEnd, [&meanCoefficients](int i, const float *m) {
+		std::copy(m, m + 4 * meanCoefficients.cols, meanCoefficients.ptr<float>(i));
+	});
+}
 
-	return (boxfilter(a_r, r).mul(Ichannels[0])
-		  + boxfilter(a_g, r).mul(Ichannels[1])
-		  + boxfilter(a_b, r).mul(Ichannels[2])
-		  + boxfilter(b, r));  // Eqn. (16) in the paper;
+/**
+ * @brief Filters a range of rows of a single channel. The first sweep box filters p and I * p and turns each row
+ * into the linear coefficients a_r, a_g, a_b and b, the second one box filters the coefficients and hands them
+ * over to apply. The second sweep pulls the coefficient rows from the first one as its window slides, so they
+ * only live in the ring of the second sweep
+ *
+ * @param p input channel
+ * @param rowBegin first output row
+ * @param rowEnd output row past the last one
+ * @param apply callback that receives each output row and its mean coefficients a_r, a_g, a_b and b per pixel
+ */
+void GuidedFilterColor::sweepRows(const cv::Mat &p, int rowBegin, int rowEnd, const std::function<void(int row, const float *meanCoefficients)> &apply) const {
+	CV_Assert(p.type() == CV_32F);
+	const int rows = p.rows, cols = p.cols;
+
+	// Products of the input with the guide: p, r * p, g * p, b * p
+	BoxMeans products(rows, cols, 4, r, [this, &p, cols](int row, float *values) {
+		const float *Ir = Ichannels[0].ptr<float>(row), *Ig = Ichannels[1].ptr<float>(row), *Ib = Ichannels[2].ptr<float>(row);
+		const float *pRow = p.ptr<float>(row);
+		for (int j = 0; j < cols; j++, values += 4) {
+			values[0] = pRow[j];
+			values[1] = Ir[j] * pRow[j];
+			values[2] = Ig[j] * pRow[j];
+			values[3] = Ib[j] * pRow[j];
+		}
+	}, workspace, PRODUCT_SWEEP);
+
+	// Linear coefficients a_r, a_g, a_b, b of the rows requested by the second sweep, which come in order and
+	// repeat the first and last rows of the image on its borders
+	cv::Mat rowBuffers[3];
+	for (int k = 0; k < 3; k++) rowBuffers[k] = FrameWorkspace::AcquireThread(workspace, FrameWorkspace::THREAD_SCRATCH, cv::Size(cols * 4, 1), CV_32F, SWEEP_ROWS + k);
+	float *productMeans = rowBuffers[0].ptr<float>(), *coefficientRow = rowBuffers[1].ptr<float>(), *coefficientMeans = rowBuffers[2].ptr<float>();
+	int coefficientsRow = std::max(rowBegin - r / 2, 0) - 1;
+	products.start(coefficientsRow + 1);
+	BoxMeans coefficients(rows, cols, 4, r, [&](int row, float *values) {
+		while (coefficientsRow < row) {
+			products.next(productMeans);
+			coefficientsRow++;
+			const float *mr = mean_I_r.ptr<float>(coefficientsRow), *mg = mean_I_g.ptr<float>(coefficientsRow), *mb = mean_I_b.ptr<float>(coefficientsRow);
+			const float *rr = invrr.ptr<float>(coefficientsRow), *rg = invrg.ptr<float>(coefficientsRow), *rb = invrb.ptr<float>(coefficientsRow);
+			const float *gg = invgg.ptr<float>(coefficientsRow), *gb = invgb.ptr<float>(coefficientsRow), *bb = invbb.ptr<float>(coefficientsRow);
+			for (int j = 0; j < cols; j++) {
+				const float *m = &productMeans[j * 4];
+				float *a = &coefficientRow[j * 4];
+
+				// covariance of (I, p) in each local patch.
+				const float cov_Ip_r = m[1] - mr[j] * m[0];
+				const float cov_Ip_g = m[2] - mg[j] * m[0];
+				const float cov_Ip_b = m[3] - mb[j] * m[0];
+
+				a[0] = rr[j] * cov_Ip_r + rg[j] * cov_Ip_g + rb[j] * cov_Ip_b;
+				a[1] = rg[j] * cov_Ip_r + gg[j] * cov_Ip_g + gb[j] * cov_Ip_b;
+				a[2] = rb[j] * cov_Ip_r + gb[j] * cov_Ip_g + bb[j] * cov_Ip_b;
+				a[3] = m[0] - a[0] * mr[j] - a[1] * mg[j] - a[2] * mb[j]; // Eqn. (15) in the paper;
+			}
+		}
+		std::copy(coefficientRow, coefficientRow + 4 * cols, values);
+	}, workspace, COEFFICIENT_SWEEP);
+
+	coefficients.start(rowBegin);
+	for (int i = rowBegin; i < rowEnd; i++) {
+		coefficients.next(coefficientMeans);
+		apply(i, coefficientMeans);
+	}
 }
 
 /**
@@ -179,14 +610,56 @@ cv::Mat GuidedFilterColor::filterSingleChannel(const cv::Mat &p) const {
  * @param I Guiding image
  * @param r window radius
  * @param eps epsilon value
+ * @param s subsampling factor of the linear coefficients, 1 runs the filter at full resolution
+ * @param workspace buffers reused across frames, null allocates them for this filter
  */
-GuidedFilter::GuidedFilter(const cv::Mat &I, int r, double eps) {
+GuidedFilter::GuidedFilter(const cv::Mat &I, int r, double eps, int s, FrameWorkspace *workspace) {
 	CV_Assert(I.channels() == 1 || I.channels() == 3);
+	CV_Assert(s >= 1);
+
+	// The coefficients of the fast filter are computed on the subsampled guide with the radius scaled accordingly
+	cv::Mat subI = I;
+	if (s > 1) {
+		const cv::Size smallSize((I.cols + s - 1) / s, (I.rows + s - 1) / s);
+		subI = FrameWorkspace::Acquire(workspace, FrameWorkspace::GUIDE_PLANES, smallSize, I.type(), RESAMPLED_IMAGE);
+		cv::resize(I, subI, smallSize, 0, 0, cv::INTER_AREA);
+		r = std::max(r / s, 1);
+	}
 
 	if (I.channels() == 1)
-		impl_ = new GuidedFilterMono(I, 2 * r + 1, eps);
+		impl_ = new GuidedFilterMono(subI, 2 * r + 1, eps, workspace);
 	else
-		impl_ = new GuidedFilterColor(I, 2 * r + 1, eps);
+		impl_ = new GuidedFilterColor(subI, 2 * r + 1, eps, workspace);
+
+	if (s > 1) impl_->subsample(I, s);
+}
+
+/**
+ * @brief Construct a new Guided Filter over the planes of a color guide, which are read in place
+ *
+ * @param I CV_32F planes of the guiding image
+ * @param r window radius
+ * @param eps epsilon value
+ * @param s subsampling factor of the linear coefficients, 1 runs the filter at full resolution
+ * @param workspace buffers reused across frames, null allocates them for this filter
+ */
+GuidedFilter::GuidedFilter(const cv::Mat I[3], int r, double eps, int s, FrameWorkspace *workspace) {
+	CV_Assert(s >= 1);
+
+	// The coefficients of the fast filter are computed on the subsampled guide with the radius scaled accordingly
+	std::vector<cv::Mat> subI(I, I + 3);
+	if (s > 1) {
+		const cv::Size smallSize((I[0].cols + s - 1) / s, (I[0].rows + s - 1) / s);
+		for (int c = 0; c < 3; c++) {
+			subI[(std::size_t) c] = FrameWorkspace::Acquire(workspace, FrameWorkspace::GUIDE_PLANES, smallSize, I[c].type(), RESAMPLED_IMAGE + c);
+			cv::resize(I[c], subI[(std::size_t) c], smallSize, 0, 0, cv::INTER_AREA);
+		}
+		r = std::max(r / s, 1);
+	}
+
+	impl_ = new GuidedFilterColor(subI.data(), 2 * r + 1, eps, workspace);
+
+	if (s > 1) impl_->subsample(I, 3, s);
 }
 
 GuidedFilter::~GuidedFilter() {
@@ -204,6 +677,25 @@ cv::Mat GuidedFilter::filter(const cv::Mat &p, int depth) const {
 	return impl_->filter(p, depth);
 }
 
-cv::Mat guidedFilter(const cv::Mat &I, const cv::Mat &p, int r, double eps, int depth) {
-	return GuidedFilter(I, r, eps).filter(p, depth);
+/**
+ * @brief Computes a guided filter over the planes of an image
+ *
+ * @param p input planes of the guide depth
+ * @param channels number of input planes
+ * @param q output planes, the same size as the input planes
+ */
+void GuidedFilter::filter(const cv::Mat p[], int channels, cv::Mat q[]) const {
+	impl_->filter(p, channels, q);
+}
+
+cv::Mat guidedFilter(const cv::Mat &I, const cv::Mat &p, int r, double eps, int depth, FrameWorkspace *workspace) {
+	return GuidedFilter(I, r, eps, 1, workspace).filter(p, depth);
+}
+
+cv::Mat fastGuidedFilter(const cv::Mat &I, const cv::Mat &p, int r, double eps, int s, int depth, FrameWorkspace *workspace) {
+	return GuidedFilter(I, r, eps, s, workspace).filter(p, depth);
+}
+
+void guidedFilter(const cv::Mat I[3], const cv::Mat p[3], cv::Mat q[3], int r, double eps, int s, FrameWorkspace *workspace) {
+	GuidedFilter(I, r, eps, s, workspace).filter(p, 3, q);
 }
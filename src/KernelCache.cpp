@@ -0,0 +1,71 @@
+#include "KernelCache.hpp"
+
+/**
+ * @brief KernelCache class constructor. Starts with an empty cache
+ *
+ */
+KernelCache::KernelCache(): hits(0), misses(0) {}
+
+/**
+ * @brief Gets a kernel from the cache, building and storing it on a miss. The kernel is built outside of the
+ * lock so builders can request other kernels, if two threads miss at once the first stored kernel is kept
+ *
+ * @param kind kernel kind
+ * @param windowSize processing window size
+ * @param sigma standard deviation of the kernel
+ * @param build function that builds the kernel
+ * @return const Mat& kernel entry of the cache, valid until Clear(). Clone it before writing to it
+ */
+const Mat &KernelCache::Get(Kind kind, int windowSize, double sigma, const std::function<Mat()> &build) {
+	const Key key(kind, windowSize, sigma);
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		auto kernel = kernels.find(key);
+		if (kernel != kernels.end()) {
+			hits++;
+			return kernel->second;
+		}
+	}
+
+	misses++;
+	Mat kernel = build();
+
+	std::lock_guard<std::mutex> lock(mutex);
+	return kernels.emplace(key, kernel).first->second;
+}
+
+/**
+ * @brief Gets the number of kernels found in the cache since the last counter reset
+ *
+ * @return unsigned long cache hits
+ */
+unsigned long KernelCache::Hits() const {
+	return hits;
+}
+
+/**
+ * @brief Gets the number of kernels built since the last counter reset
+ *
+ * @return unsigned long cache misses
+ */
+unsigned long KernelCache::Misses() const {
+	return misses;
+}
+
+/**
+ * @brief Resets the hit and miss counters, the cached kernels are kept
+ *
+ */
+void KernelCache::ResetCounters() {
+	hits = 0;
+	misses = 0;
+}
+
+/**
+ * @brief Removes all the cached kernels
+ *
+ */
+void KernelCache::Clear() {
+	std::lock_guard<std::mutex> lock(mutex);
+	kernels.clear();
+}
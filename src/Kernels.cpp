@@ -0,0 +1,1188 @@
+#include "Kernels.hpp"
+
+#include <cmath>
+#include <cfloat>
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define KERNELS_X86
+#include <immintrin.h>
+#endif
+
+Kernels::ISA Kernels::activeISA = Kernels::DetectISA();
+
+/**
+ * @brief Gets the address of a plane element
+ *
+ * @param plane plane data
+ * @param step plane row step in floats
+ * @param row element row, has to be inside of the plane
+ * @param col element column, has to be inside of the plane
+ * @return const float* element address
+ */
+static inline const float *PlaneAt(const float *plane, std::size_t step, int row, int col) {
+	return plane + (std::ptrdiff_t) row * (std::ptrdiff_t) step + col;
+}
+
+/**
+ * @brief Evaluates a range weight \f$ \exp(\alpha (d - \beta)) \f$ through the lookup table if there is one
+ *
+ * @param lut lookup table, can be null
+ * @param distance squared distance \f$ d \f$
+ * @param factor exponent factor \f$ \alpha \f$
+ * @param offset distance offset \f$ \beta \f$
+ * @return float weight
+ */
+static inline float RangeWeight(const GaussianLUT *lut, float distance, float factor, float offset) {
+	return lut ? (*lut)(distance) : std::exp(factor * (distance - offset));
+}
+
+/**
+ * @brief Scalar bilateral filter for a single output pixel. Also used for the row tails of the vectorized kernels
+ *
+ * @param args kernel arguments
+ * @param row output row
+ * @param col output column
+ */
+template<int WS>
+static void BilateralPixelScalar(const BilateralArgs &args, int row, int col) {
+	const int windowSize = WS ? WS : args.windowSize;
+	const int padding = windowSize / 2;
+	const float centerL = *PlaneAt(args.weighting[0], args.step, row, col);
+	const float centerA = *PlaneAt(args.weighting[1], args.step, row, col);
+	const float centerB = *PlaneAt(args.weighting[2], args.step, row, col);
+
+	float norm = 0.0f, sumL = 0.0f, sumA = 0.0f, sumB = 0.0f;
+	for (int k = 0; k < windowSize; k++) {
+		const float *wL = PlaneAt(args.weighting[0], args.step, row - padding + k, col - padding);
+		const float *wA = PlaneAt(args.weighting[1], args.step, row - padding + k, col - padding);
+		const float *wB = PlaneAt(args.weighting[2], args.step, row - padding + k, col - padding);
+		const float *iL = PlaneAt(args.input[0], args.step, row - padding + k, col - padding);
+		const float *iA = PlaneAt(args.input[1], args.step, row - padding + k, col - padding);
+		const float *iB = PlaneAt(args.input[2], args.step, row - padding + k, col - padding);
+		const float *spatialRow = args.spatialKernel + k * windowSize;
+		#pragma GCC unroll 8
+		for (int l = 0; l < windowSize; l++) {
+			float dL = wL[l] - centerL, dA = wA[l] - centerA, dB = wB[l] - centerB;
+			float weight = spatialRow[l] * RangeWeight(args.rangeLUT, dL * dL + dA * dA + dB * dB, args.rangeFactor, 0.0f);
+			norm += weight;
+			sumL += weight * iL[l];
+			sumA += weight * iA[l];
+			sumB += weight * iB[l];
+		}
+	}
+
+	std::size_t offset = (std::size_t) row * args.outputStep + (std::size_t) col * (std::size_t) args.outputStride;
+	args.output[0][offset] = sumL / norm;
+	args.output[1][offset] = sumA / norm;
+	args.output[2][offset] = sumB / norm;
+}
+
+/**
+ * @brief Scalar bilateral row kernel
+ */
+template<int WS>
+static void BilateralRowScalar(const BilateralArgs &args, int row, int colBegin, int colEnd) {
+	for (int j = colBegin; j < colEnd; j++) BilateralPixelScalar<WS>(args, row, j);
+}
+
+/**
+ * @brief Scalar bilateral filter for a pixel whose window crosses the image border. The pixels outside of the
+ * image are zero (constant border), so they only add their weight to the norm
+ *
+ * @param args kernel arguments
+ * @param row output row
+ * @param col output column
+ */
+static void BilateralPixelBorder(const BilateralArgs &args, int row, int col) {
+	const int windowSize = args.windowSize;
+	const int padding = windowSize / 2;
+	float center[3];
+	for (int c = 0; c < 3; c++) center[c] = *PlaneAt(args.weighting[c], args.step, row, col);
+
+	float norm = 0.0f, sum[3] = {0.0f, 0.0f, 0.0f};
+	for (int k = 0; k < windowSize; k++) {
+		const int y = row - padding + k;
+		const float *spatialRow = args.spatialKernel + k * windowSize;
+		for (int l = 0; l < windowSize; l++) {
+			const int x = col - padding + l;
+			const bool inside = y >= 0 && y < args.rows && x >= 0 && x < args.cols;
+			float distance = 0.0f, input[3] = {0.0f, 0.0f, 0.0f};
+			for (int c = 0; c < 3; c++) {
+				float difference = (inside ? *PlaneAt(args.weighting[c], args.step, y, x) : 0.0f) - center[c];
+				distance += difference * difference;
+				if (inside) input[c] = *PlaneAt(args.input[c], args.step, y, x);
+			}
+			float weight = spatialRow[l] * RangeWeight(args.rangeLUT, distance, args.rangeFactor, 0.0f);
+			norm += weight;
+			for (int c = 0; c < 3; c++) sum[c] += weight * input[c];
+		}
+	}
+
+	std::size_t offset = (std::size_t) row * args.outputStep + (std::size_t) col * (std::size_t) args.outputStride;
+	for (int c = 0; c < 3; c++) args.output[c][offset] = sum[c] / norm;
+}
+
+/**
+ * @brief Scalar symmetric bilateral kernel for one window offset \f$ (k, l) \f$ after the pixel in raster order.
+ * Every pixel \f$ p \f$ of the columns evaluates its pair with \f$ q = p + (k, l) \f$ once and accumulates it into
+ * both sums. Also used for the row tails of the vectorized kernels
+ *
+ * @param args kernel arguments
+ * @param row pixel row
+ * @param k row offset of the pair, in [0, windowSize / 2]
+ * @param l column offset of the pair, positive if k is zero
+ * @param sums accumulator rows of the L, a, b sums and the norm for the pixel row
+ * @param sumStep distance in floats between two consecutive accumulator rows
+ * @param colBegin first pixel column, the pair has to be inside of the image
+ * @param colEnd last pixel column (excluded)
+ */
+static void SymmetricBilateralOffsetScalar(const BilateralArgs &args, int row, int k, int l, float *const sums[4], std::size_t sumStep, int colBegin, int colEnd) {
+	const int padding = args.windowSize / 2;
+	const float spatial = args.spatialKernel[(padding + k) * args.windowSize + padding + l];
+	const std::size_t scatter = (std::size_t) k * sumStep;
+	for (int j = colBegin; j < colEnd; j++) {
+		float distance = 0.0f;
+		for (int c = 0; c < 3; c++) {
+			float difference = *PlaneAt(args.weighting[c], args.step, row, j) - *PlaneAt(args.weighting[c], args.step, row + k, j + l);
+			distance += difference * difference;
+		}
+		const float weight = spatial * RangeWeight(args.rangeLUT, distance, args.rangeFactor, 0.0f);
+		for (int c = 0; c < 3; c++) {
+			sums[c][j] += weight * *PlaneAt(args.input[c], args.step, row + k, j + l);
+			sums[c][scatter + (std::size_t) (j + l)] += weight * *PlaneAt(args.input[c], args.step, row, j);
+		}
+		sums[3][j] += weight;
+		sums[3][scatter + (std::size_t) (j + l)] += weight;
+	}
+}
+
+/**
+ * @brief Adds the weight of the zeros outside of the image to the norm of a pixel whose window crosses the image
+ * border. Their range weight is the one of \f$ ||U(p)||^2 \f$ and their input is zero
+ *
+ * @param args kernel arguments
+ * @param row pixel row
+ * @param col pixel column
+ * @param norm norm accumulator of the pixel
+ */
+static void SymmetricBilateralOutside(const BilateralArgs &args, int row, int col, float &norm) {
+	const int padding = args.windowSize / 2;
+	float outsideSpatial = 0.0f;
+	for (int k = 0; k < args.windowSize; k++) {
+		const int y = row - padding + k;
+		for (int l = 0; l < args.windowSize; l++) {
+			const int x = col - padding + l;
+			if (y < 0 || y >= args.rows || x < 0 || x >= args.cols) outsideSpatial += args.spatialKernel[k * args.windowSize + l];
+		}
+	}
+	if (outsideSpatial == 0.0f) return;
+
+	float distance = 0.0f;
+	for (int c = 0; c < 3; c++) {
+		float value = *PlaneAt(args.weighting[c], args.step, row, col);
+		distance += value * value;
+	}
+	norm += outsideSpatial * RangeWeight(args.rangeLUT, distance, args.rangeFactor, 0.0f);
+}
+
+/**
+ * @brief Scalar non local means weighting and accumulation for a single output pixel
+ *
+ * @param args kernel arguments
+ * @param distances continuous windowSize x windowSize patch distances
+ * @param row output row
+ * @param col output column
+ * @param output three output channel values
+ */
+template<int WS>
+static void NonLocalMeansPixelScalar(const NonLocalMeansArgs &args, const float *distances, int row, int col, float *output) {
+	const int windowSize = WS ? WS : args.windowSize;
+	const int padding = windowSize / 2;
+	float norm = 0.0f, sumL = 0.0f, sumA = 0.0f, sumB = 0.0f;
+	for (int k = 0; k < windowSize; k++) {
+		const float *iL = PlaneAt(args.input[0], args.step, row - padding + k, col - padding);
+		const float *iA = PlaneAt(args.input[1], args.step, row - padding + k, col - padding);
+		const float *iB = PlaneAt(args.input[2], args.step, row - padding + k, col - padding);
+		const float *distanceRow = distances + k * windowSize;
+		#pragma GCC unroll 8
+		for (int l = 0; l < windowSize; l++) {
+			float weight = RangeWeight(args.weightLUT, distanceRow[l], args.weightFactor, args.weightOffset);
+			norm += weight;
+			sumL += weight * iL[l];
+			sumA += weight * iA[l];
+			sumB += weight * iB[l];
+		}
+	}
+	output[0] = sumL / norm;
+	output[1] = sumA / norm;
+	output[2] = sumB / norm;
+}
+
+/**
+ * @brief Scalar non local means weighting for a pixel whose window crosses the image border. The input pixels
+ * outside of the image are zero (constant border)
+ *
+ * @param args kernel arguments
+ * @param distances continuous windowSize x windowSize patch distances
+ * @param row output row
+ * @param col output column
+ * @param output three output channel values
+ */
+static void NonLocalMeansPixelBorder(const NonLocalMeansArgs &args, const float *distances, int row, int col, float *output) {
+	const int windowSize = args.windowSize;
+	const int padding = windowSize / 2;
+	float norm = 0.0f, sum[3] = {0.0f, 0.0f, 0.0f};
+	for (int k = 0; k < windowSize; k++) {
+		const int y = row - padding + k;
+		for (int l = 0; l < windowSize; l++) {
+			const int x = col - padding + l;
+			float weight = RangeWeight(args.weightLUT, distances[k * windowSize + l], args.weightFactor, args.weightOffset);
+			norm += weight;
+			if (y < 0 || y >= args.rows || x < 0 || x >= args.cols) continue;
+			for (int c = 0; c < 3; c++) sum[c] += weight * *PlaneAt(args.input[c], args.step, y, x);
+		}
+	}
+	for (int c = 0; c < 3; c++) output[c] = sum[c] / norm;
+}
+
+/**
+ * @brief Computes the squared CIELab distances between the patch at the window corner and the patch of every window
+ * pixel. The patches that leave the window replicate its border, the window itself is read from the image planes.
+ * Each channel is accumulated in double precision and divided by the neighborhood size before adding the channels
+ *
+ * @param window three plane addresses of the window's first pixel
+ * @param step plane row step in floats
+ * @param windowSize processing window size
+ * @param neighborhoodSize patch size
+ * @param candidates windowSize x windowSize flags of the patches to compare, the others get the largest distance. Can be null
+ * @param distances continuous windowSize x windowSize output distances
+ */
+template<int WS>
+static void PatchDistancesScalar(const float *const *window, std::size_t step, int windowSize, int neighborhoodSize, const unsigned char *candidates, float *distances) {
+	if (WS) windowSize = WS;
+	const int padding = windowSize / 2;
+	auto clamp = [windowSize](int index) { return std::min(std::max(index, 0), windowSize - 1); };
+	for (int i = 0; i < windowSize; i++) {
+		for (int j = 0; j < windowSize; j++) {
+			// Discarded candidates get a null weight
+			if (candidates && !candidates[i * windowSize + j]) {
+				distances[i * windowSize + j] = FLT_MAX;
+				continue;
+			}
+
+			// Columns of the patches that stay inside the window need no clamping
+			const bool inside = j >= padding && j - padding + neighborhoodSize <= windowSize && neighborhoodSize <= windowSize;
+			double distance[3] = {0.0, 0.0, 0.0};
+			for (int c = 0; c < 3; c++) {
+				for (int k = 0; k < neighborhoodSize; k++) {
+					const float *fixedRow = PlaneAt(window[c], step, clamp(k), 0);
+					const float *slidingRow = PlaneAt(window[c], step, clamp(i - padding + k), 0);
+					if (inside) {
+						slidingRow += j - padding;
+						for (int l = 0; l < neighborhoodSize; l++) {
+							double difference = (double) fixedRow[l] - (double) slidingRow[l];
+							distance[c] += difference * difference;
+						}
+					}
+					else {
+						for (int l = 0; l < neighborhoodSize; l++) {
+							double difference = (double) fixedRow[clamp(l)] - (double) slidingRow[clamp(j - padding + l)];
+							distance[c] += difference * difference;
+						}
+					}
+				}
+			}
+			distances[i * windowSize + j] = (float) distance[0] / (float) neighborhoodSize
+				+ (float) distance[1] / (float) neighborhoodSize
+				+ (float) distance[2] / (float) neighborhoodSize;
+		}
+	}
+}
+
+// Accumulated columns of the vectorized patch distance kernels, the largest specialized window rounded up to the lanes
+static const int PATCH_COLUMNS = Kernels::MAX_SPECIALIZED_WINDOW + 1;
+
+/**
+ * @brief Copies a window row with its border replicated, so the vectorized patch distance kernels read the patches
+ * of every window column without clamping. Element x holds the window column x - padding clamped to the window
+ *
+ * @param row window row
+ * @param windowSize processing window size
+ * @param length number of elements to write
+ * @param extended output row
+ */
+static inline void ReplicateRow(const float *row, int windowSize, int length, float *extended) {
+	const int padding = windowSize / 2;
+	for (int x = 0; x < length; x++) extended[x] = row[std::min(std::max(x - padding, 0), windowSize - 1)];
+}
+
+/**
+ * @brief Writes a row of patch distances from the channel sums of the vectorized kernels, in the order of the scalar kernel
+ *
+ * @param sums channel sums of the row
+ * @param windowSize processing window size
+ * @param neighborhoodSize patch size
+ * @param candidates row of candidate flags, can be null
+ * @param distances output row
+ */
+static inline void StorePatchDistanceRow(const double sums[3][PATCH_COLUMNS], int windowSize, int neighborhoodSize, const unsigned char *candidates, float *distances) {
+	for (int j = 0; j < windowSize; j++)
+		distances[j] = candidates && !candidates[j] ? FLT_MAX : (float) sums[0][j] / (float) neighborhoodSize
+			+ (float) sums[1][j] / (float) neighborhoodSize
+			+ (float) sums[2][j] / (float) neighborhoodSize;
+}
+
+/**
+ * @brief Checks whether a row of the processing window has no patch to compare
+ */
+static inline bool DiscardedRow(const unsigned char *candidates, int windowSize) {
+	return candidates && std::none_of(candidates, candidates + windowSize, [](unsigned char candidate) { return candidate; });
+}
+
+/**
+ * @brief Writes the lanes of three vectorized channel sums to the (possibly interleaved) output row
+ */
+static inline void StoreLanes(const BilateralArgs &args, int row, int col, int lanes, const float *L, const float *A, const float *B) {
+	std::size_t offset = (std::size_t) row * args.outputStep + (std::size_t) col * (std::size_t) args.outputStride;
+	for (int n = 0; n < lanes; n++) {
+		args.output[0][offset] = L[n];
+		args.output[1][offset] = A[n];
+		args.output[2][offset] = B[n];
+		offset += (std::size_t) args.outputStride;
+	}
+}
+
+#ifdef KERNELS_X86
+
+// GCC's AVX-512 intrinsic headers self initialize their undefined vectors, which trips these warnings.
+// Without optimizations the gather intrinsics are macros that cast their full mask to a signed type
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#pragma GCC diagnostic ignored "-Wsign-conversion"
+
+/**
+ * Vectorized exponential shared by every instruction set. It follows the Cephes expf range reduction
+ * \f$ e^x = 2^n e^r \f$ with \f$ |r| \leq \ln(2)/2 \f$ and a degree 6 polynomial for \f$ e^r \f$,
+ * giving a relative error below \f$ 2 \cdot 10^{-7} \f$ in the clamped range \f$ [-87.3, 88.3] \f$
+ */
+#define EXP_HI 88.3762626647949f
+#define EXP_LO -87.3365447504019f
+#define EXP_LOG2E 1.44269504088896341f
+#define EXP_C1 0.693359375f
+#define EXP_C2 -2.12194440e-4f
+#define EXP_P0 1.9875691500e-4f
+#define EXP_P1 1.3981999507e-3f
+#define EXP_P2 8.3334519073e-3f
+#define EXP_P3 4.1665795894e-2f
+#define EXP_P4 1.6666665459e-1f
+#define EXP_P5 5.0000001201e-1f
+
+__attribute__((target("sse4.1")))
+static inline __m128 Exp128(__m128 x) {
+	x = _mm_min_ps(_mm_max_ps(x, _mm_set1_ps(EXP_LO)), _mm_set1_ps(EXP_HI));
+	__m128 n = _mm_floor_ps(_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(EXP_LOG2E)), _mm_set1_ps(0.5f)));
+	x = _mm_sub_ps(x, _mm_mul_ps(n, _mm_set1_ps(EXP_C1)));
+	x = _mm_sub_ps(x, _mm_mul_ps(n, _mm_set1_ps(EXP_C2)));
+	__m128 x2 = _mm_mul_ps(x, x);
+	__m128 y = _mm_set1_ps(EXP_P0);
+	y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(EXP_P1));
+	y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(EXP_P2));
+	y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(EXP_P3));
+	y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(EXP_P4));
+	y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(EXP_P5));
+	y = _mm_add_ps(_mm_add_ps(_mm_mul_ps(y, x2), x), _mm_set1_ps(1.0f));
+	__m128i exponent = _mm_slli_epi32(_mm_add_epi32(_mm_cvttps_epi32(n), _mm_set1_epi32(127)), 23);
+	return _mm_mul_ps(y, _mm_castsi128_ps(exponent));
+}
+
+__attribute__((target("avx2,fma")))
+static inline __m256 Exp256(__m256 x) {
+	x = _mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(EXP_LO)), _mm256_set1_ps(EXP_HI));
+	__m256 n = _mm256_floor_ps(_mm256_fmadd_ps(x, _mm256_set1_ps(EXP_LOG2E), _mm256_set1_ps(0.5f)));
+	x = _mm256_fnmadd_ps(n, _mm256_set1_ps(EXP_C1), x);
+	x = _mm256_fnmadd_ps(n, _mm256_set1_ps(EXP_C2), x);
+	__m256 x2 = _mm256_mul_ps(x, x);
+	__m256 y = _mm256_set1_ps(EXP_P0);
+	y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(EXP_P1));
+	y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(EXP_P2));
+	y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(EXP_P3));
+	y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(EXP_P4));
+	y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(EXP_P5));
+	y = _mm256_add_ps(_mm256_fmadd_ps(y, x2, x), _mm256_set1_ps(1.0f));
+	__m256i exponent = _mm256_slli_epi32(_mm256_add_epi32(_mm256_cvttps_epi32(n), _mm256_set1_epi32(127)), 23);
+	return _mm256_mul_ps(y, _mm256_castsi256_ps(exponent));
+}
+
+__attribute__((target("avx512f")))
+static inline __m512 Exp512(__m512 x) {
+	x = _mm512_min_ps(_mm512_max_ps(x, _mm512_set1_ps(EXP_LO)), _mm512_set1_ps(EXP_HI));
+	__m512 n = _mm512_floor_ps(_mm512_fmadd_ps(x, _mm512_set1_ps(EXP_LOG2E), _mm512_set1_ps(0.5f)));
+	x = _mm512_fnmadd_ps(n, _mm512_set1_ps(EXP_C1), x);
+	x = _mm512_fnmadd_ps(n, _mm512_set1_ps(EXP_C2), x);
+	__m512 x2 = _mm512_mul_ps(x, x);
+	__m512 y = _mm512_set1_ps(EXP_P0);
+	y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(EXP_P1));
+	y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(EXP_P2));
+	y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(EXP_P3));
+	y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(EXP_P4));
+	y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(EXP_P5));
+	y = _mm512_add_ps(_mm512_fmadd_ps(y, x2, x), _mm512_set1_ps(1.0f));
+	__m512i exponent = _mm512_slli_epi32(_mm512_add_epi32(_mm512_cvttps_epi32(n), _mm512_set1_epi32(127)), 23);
+	return _mm512_mul_ps(y, _mm512_castsi512_ps(exponent));
+}
+
+__attribute__((target("sse4.1")))
+static inline float HorizontalSum128(__m128 v) {
+	v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+	v = _mm_add_ss(v, _mm_shuffle_ps(v, v, 1));
+	return _mm_cvtss_f32(v);
+}
+
+__attribute__((target("avx2,fma")))
+static inline float HorizontalSum256(__m256 v) {
+	__m128 v128 = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+	v128 = _mm_add_ps(v128, _mm_movehl_ps(v128, v128));
+	v128 = _mm_add_ss(v128, _mm_shuffle_ps(v128, v128, 1));
+	return _mm_cvtss_f32(v128);
+}
+
+/**
+ * Vectorized lookup table evaluation. The positions are clamped to the last table interval, whose
+ * entries are zero, and to the first one, so the interpolation reads stay inside the table. A NaN distance
+ * gets the zero weight of the last interval, as in the scalar lookup. SSE4 has no gather instruction,
+ * so its lanes are looked up one at a time
+ */
+__attribute__((target("sse4.1")))
+static inline __m128 Lookup128(const GaussianLUT &lut, __m128 distance) {
+	alignas(16) float d[4];
+	_mm_store_ps(d, distance);
+	return _mm_setr_ps(lut(d[0]), lut(d[1]), lut(d[2]), lut(d[3]));
+}
+
+__attribute__((target("avx2,fma")))
+static inline __m256 Lookup256(const GaussianLUT &lut, __m256 distance) {
+	__m256 x = _mm256_min_ps(_mm256_mul_ps(distance, _mm256_set1_ps(lut.Scale())), _mm256_set1_ps((float) GaussianLUT::SIZE));
+	x = _mm256_max_ps(x, _mm256_setzero_ps());
+	__m256i i = _mm256_cvttps_epi32(x);
+	__m256 fraction = _mm256_sub_ps(x, _mm256_cvtepi32_ps(i));
+	__m256 low = _mm256_i32gather_ps(lut.Table(), i, 4);
+	__m256 high = _mm256_i32gather_ps(lut.Table() + 1, i, 4);
+	return _mm256_fmadd_ps(fraction, _mm256_sub_ps(high, low), low);
+}
+
+__attribute__((target("avx512f")))
+static inline __m512 Lookup512(const GaussianLUT &lut, __m512 distance) {
+	__m512 x = _mm512_min_ps(_mm512_mul_ps(distance, _mm512_set1_ps(lut.Scale())), _mm512_set1_ps((float) GaussianLUT::SIZE));
+	x = _mm512_max_ps(x, _mm512_setzero_ps());
+	__m512i i = _mm512_cvttps_epi32(x);
+	__m512 fraction = _mm512_sub_ps(x, _mm512_cvtepi32_ps(i));
+	__m512 low = _mm512_i32gather_ps(i, lut.Table(), 4);
+	__m512 high = _mm512_i32gather_ps(i, lut.Table() + 1, 4);
+	return _mm512_fmadd_ps(fraction, _mm512_sub_ps(high, low), low);
+}
+
+/**
+ * Vectorized range weights \f$ \exp(\alpha (d - \beta)) \f$, either from the lookup table or from the exponential
+ */
+template<bool UseLUT>
+__attribute__((target("sse4.1")))
+static inline __m128 RangeWeight128([[maybe_unused]] const GaussianLUT *lut, __m128 distance, [[maybe_unused]] __m128 factor, [[maybe_unused]] __m128 offset) {
+	if constexpr (UseLUT) return Lookup128(*lut, distance);
+	else return Exp128(_mm_mul_ps(_mm_sub_ps(distance, offset), factor));
+}
+
+template<bool UseLUT>
+__attribute__((target("avx2,fma")))
+static inline __m256 RangeWeight256([[maybe_unused]] const GaussianLUT *lut, __m256 distance, [[maybe_unused]] __m256 factor, [[maybe_unused]] __m256 offset) {
+	if constexpr (UseLUT) return Lookup256(*lut, distance);
+	else return Exp256(_mm256_mul_ps(_mm256_sub_ps(distance, offset), factor));
+}
+
+template<bool UseLUT>
+__attribute__((target("avx512f")))
+static inline __m512 RangeWeight512([[maybe_unused]] const GaussianLUT *lut, __m512 distance, [[maybe_unused]] __m512 factor, [[maybe_unused]] __m512 offset) {
+	if constexpr (UseLUT) return Lookup512(*lut, distance);
+	else return Exp512(_mm512_mul_ps(_mm512_sub_ps(distance, offset), factor));
+}
+
+/**
+ * @brief SSE4 bilateral row kernel. Processes four output pixels per instruction
+ */
+template<int WS, bool UseLUT>
+__attribute__((target("sse4.1")))
+static void BilateralRowSSE4(const BilateralArgs &args, int row, int colBegin, int colEnd) {
+	const int windowSize = WS ? WS : args.windowSize;
+	const int padding = windowSize / 2;
+	const __m128 rangeFactor = _mm_set1_ps(args.rangeFactor);
+	alignas(16) float L[4], A[4], B[4];
+
+	int j = colBegin;
+	for (; j + 4 <= colEnd; j += 4) {
+		const __m128 centerL = _mm_loadu_ps(PlaneAt(args.weighting[0], args.step, row, j));
+		const __m128 centerA = _mm_loadu_ps(PlaneAt(args.weighting[1], args.step, row, j));
+		const __m128 centerB = _mm_loadu_ps(PlaneAt(args.weighting[2], args.step, row, j));
+		__m128 norm = _mm_setzero_ps(), sumL = _mm_setzero_ps(), sumA = _mm_setzero_ps(), sumB = _mm_setzero_ps();
+		for (int k = 0; k < windowSize; k++) {
+			const float *wL = PlaneAt(args.weighting[0], args.step, row - padding + k, j - padding);
+			const float *wA = PlaneAt(args.weighting[1], args.step, row - padding + k, j - padding);
+			const float *wB = PlaneAt(args.weighting[2], args.step, row - padding + k, j - padding);
+			const float *iL = PlaneAt(args.input[0], args.step, row - padding + k, j - padding);
+			const float *iA = PlaneAt(args.input[1], args.step, row - padding + k, j - padding);
+			const float *iB = PlaneAt(args.input[2], args.step, row - padding + k, j - padding);
+			const float *spatialRow = args.spatialKernel + k * windowSize;
+			#pragma GCC unroll 8
+			for (int l = 0; l < windowSize; l++) {
+				__m128 dL = _mm_sub_ps(_mm_loadu_ps(wL + l), centerL);
+				__m128 dA = _mm_sub_ps(_mm_loadu_ps(wA + l), centerA);
+				__m128 dB = _mm_sub_ps(_mm_loadu_ps(wB + l), centerB);
+				__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dL, dL), _mm_mul_ps(dA, dA)), _mm_mul_ps(dB, dB));
+				__m128 weight = _mm_mul_ps(_mm_set1_ps(spatialRow[l]), RangeWeight128<UseLUT>(args.rangeLUT, distance, rangeFactor, _mm_setzero_ps()));
+				norm = _mm_add_ps(norm, weight);
+				sumL = _mm_add_ps(sumL, _mm_mul_ps(weight, _mm_loadu_ps(iL + l)));
+				sumA = _mm_add_ps(sumA, _mm_mul_ps(weight, _mm_loadu_ps(iA + l)));
+				sumB = _mm_add_ps(sumB, _mm_mul_ps(weight, _mm_loadu_ps(iB + l)));
+			}
+		}
+		_mm_store_ps(L, _mm_div_ps(sumL, norm));
+		_mm_store_ps(A, _mm_div_ps(sumA, norm));
+		_mm_store_ps(B, _mm_div_ps(sumB, norm));
+		StoreLanes(args, row, j, 4, L, A, B);
+	}
+	for (; j < colEnd; j++) BilateralPixelScalar<WS>(args, row, j);
+}
+
+/**
+ * @brief AVX2 bilateral row kernel. Processes eight output pixels per instruction
+ */
+template<int WS, bool UseLUT>
+__attribute__((target("avx2,fma")))
+static void BilateralRowAVX2(const BilateralArgs &args, int row, int colBegin, int colEnd) {
+	const int windowSize = WS ? WS : args.windowSize;
+	const int padding = windowSize / 2;
+	const __m256 rangeFactor = _mm256_set1_ps(args.rangeFactor);
+	alignas(32) float L[8], A[8], B[8];
+
+	int j = colBegin;
+	for (; j + 8 <= colEnd; j += 8) {
+		const __m256 centerL = _mm256_loadu_ps(PlaneAt(args.weighting[0], args.step, row, j));
+		const __m256 centerA = _mm256_loadu_ps(PlaneAt(args.weighting[1], args.step, row, j));
+		const __m256 centerB = _mm256_loadu_ps(PlaneAt(args.weighting[2], args.step, row, j));
+		__m256 norm = _mm256_setzero_ps(), sumL = _mm256_setzero_ps(), sumA = _mm256_setzero_ps(), sumB = _mm256_setzero_ps();
+		for (int k = 0; k < windowSize; k++) {
+			const float *wL = PlaneAt(args.weighting[0], args.step, row - padding + k, j - padding);
+			const float *wA = PlaneAt(args.weighting[1], args.step, row - padding + k, j - padding);
+			const float *wB = PlaneAt(args.weighting[2], args.step, row - padding + k, j - padding);
+			const float *iL = PlaneAt(args.input[0], args.step, row - padding + k, j - padding);
+			const float *iA = PlaneAt(args.input[1], args.step, row - padding + k, j - padding);
+			const float *iB = PlaneAt(args.input[2], args.step, row - padding + k, j - padding);
+			const float *spatialRow = args.spatialKernel + k * windowSize;
+			#pragma GCC unroll 8
+			for (int l = 0; l < windowSize; l++) {
+				__m256 dL = _mm256_sub_ps(_mm256_loadu_ps(wL + l), centerL);
+				__m256 dA = _mm256_sub_ps(_mm256_loadu_ps(wA + l), centerA);
+				__m256 dB = _mm256_sub_ps(_mm256_loadu_ps(wB + l), centerB);
+				__m256 distance = _mm256_fmadd_ps(dB, dB, _mm256_fmadd_ps(dA, dA, _mm256_mul_ps(dL, dL)));
+				__m256 weight = _mm256_mul_ps(_mm256_set1_ps(spatialRow[l]), RangeWeight256<UseLUT>(args.rangeLUT, distance, rangeFactor, _mm256_setzero_ps()));
+				norm = _mm256_add_ps(norm, weight);
+				sumL = _mm256_fmadd_ps(weight, _mm256_loadu_ps(iL + l), sumL);
+				sumA = _mm256_fmadd_ps(weight, _mm256_loadu_ps(iA + l), sumA);
+				sumB = _mm256_fmadd_ps(weight, _mm256_loadu_ps(iB + l), sumB);
+			}
+		}
+		_mm256_store_ps(L, _mm256_div_ps(sumL, norm));
+		_mm256_store_ps(A, _mm256_div_ps(sumA, norm));
+		_mm256_store_ps(B, _mm256_div_ps(sumB, norm));
+		StoreLanes(args, row, j, 8, L, A, B);
+	}
+	for (; j < colEnd; j++) BilateralPixelScalar<WS>(args, row, j);
+}
+
+/**
+ * @brief AVX-512 bilateral row kernel. Processes sixteen output pixels per instruction
+ */
+template<int WS, bool UseLUT>
+__attribute__((target("avx512f")))
+static void BilateralRowAVX512(const BilateralArgs &args, int row, int colBegin, int colEnd) {
+	const int windowSize = WS ? WS : args.windowSize;
+	const int padding = windowSize / 2;
+	const __m512 rangeFactor = _mm512_set1_ps(args.rangeFactor);
+	alignas(64) float L[16], A[16], B[16];
+
+	int j = colBegin;
+	for (; j + 16 <= colEnd; j += 16) {
+		const __m512 centerL = _mm512_loadu_ps(PlaneAt(args.weighting[0], args.step, row, j));
+		const __m512 centerA = _mm512_loadu_ps(PlaneAt(args.weighting[1], args.step, row, j));
+		const __m512 centerB = _mm512_loadu_ps(PlaneAt(args.weighting[2], args.step, row, j));
+		__m512 norm = _mm512_setzero_ps(), sumL = _mm512_setzero_ps(), sumA = _mm512_setzero_ps(), sumB = _mm512_setzero_ps();
+		for (int k = 0; k < windowSize; k++) {
+			const float *wL = PlaneAt(args.weighting[0], args.step, row - padding + k, j - padding);
+			const float *wA = PlaneAt(args.weighting[1], args.step, row - padding + k, j - padding);
+			const float *wB = PlaneAt(args.weighting[2], args.step, row - padding + k, j - padding);
+			const float *iL = PlaneAt(args.input[0], args.step, row - padding + k, j - padding);
+			const float *iA = PlaneAt(args.input[1], args.step, row - padding + k, j - padding);
+			const float *iB = PlaneAt(args.input[2], args.step, row - padding + k, j - padding);
+			const float *spatialRow = args.spatialKernel + k * windowSize;
+			#pragma GCC unroll 8
+			for (int l = 0; l < windowSize; l++) {
+				__m512 dL = _mm512_sub_ps(_mm512_loadu_ps(wL + l), centerL);
+				__m512 dA = _mm512_sub_ps(_mm512_loadu_ps(wA + l), centerA);
+				__m512 dB = _mm512_sub_ps(_mm512_loadu_ps(wB + l), centerB);
+				__m512 distance = _mm512_fmadd_ps(dB, dB, _mm512_fmadd_ps(dA, dA, _mm512_mul_ps(dL, dL)));
+				__m512 weight = _mm512_mul_ps(_mm512_set1_ps(spatialRow[l]), RangeWeight512<UseLUT>(args.rangeLUT, distance, rangeFactor, _mm512_setzero_ps()));
+				norm = _mm512_add_ps(norm, weight);
+				sumL = _mm512_fmadd_ps(weight, _mm512_loadu_ps(iL + l), sumL);
+				sumA = _mm512_fmadd_ps(weight, _mm512_loadu_ps(iA + l), sumA);
+				sumB = _mm512_fmadd_ps(weight, _mm512_loadu_ps(iB + l), sumB);
+			}
+		}
+		_mm512_store_ps(L, _mm512_div_ps(sumL, norm));
+		_mm512_store_ps(A, _mm512_div_ps(sumA, norm));
+		_mm512_store_ps(B, _mm512_div_ps(sumB, norm));
+		StoreLanes(args, row, j, 16, L, A, B);
+	}
+	for (; j < colEnd; j++) BilateralPixelScalar<WS>(args, row, j);
+}
+
+/**
+ * @brief SSE4 symmetric bilateral kernel for one window offset. Processes four pixel pairs per instruction
+ */
+template<bool UseLUT>
+__attribute__((target("sse4.1")))
+static void SymmetricBilateralOffsetSSE4(const BilateralArgs &args, int row, int k, int l, float *const sums[4], std::size_t sumStep, int colBegin, int colEnd) {
+	const int padding = args.windowSize / 2;
+	const __m128 spatial = _mm_set1_ps(args.spatialKernel[(padding + k) * args.windowSize + padding + l]);
+	const __m128 rangeFactor = _mm_set1_ps(args.rangeFactor);
+	float *const scattered[4] = {sums[0] + (std::size_t) k * sumStep + l, sums[1] + (std::size_t) k * sumStep + l, sums[2] + (std::size_t) k * sumStep + l, sums[3] + (std::size_t) k * sumStep + l};
+
+	int j = colBegin;
+	for (; j + 4 <= colEnd; j += 4) {
+		__m128 distance = _mm_setzero_ps();
+		for (int c = 0; c < 3; c++) {
+			__m128 difference = _mm_sub_ps(_mm_loadu_ps(PlaneAt(args.weighting[c], args.step, row, j)), _mm_loadu_ps(PlaneAt(args.weighting[c], args.step, row + k, j + l)));
+			distance = _mm_add_ps(distance, _mm_mul_ps(difference, difference));
+		}
+		const __m128 weight = _mm_mul_ps(spatial, RangeWeight128<UseLUT>(args.rangeLUT, distance, rangeFactor, _mm_setzero_ps()));
+
+		// With k = 0 the scattered sums overlap the gathered ones, so each sum is stored before the next one is loaded
+		for (int c = 0; c < 3; c++)
+			_mm_storeu_ps(sums[c] + j, _mm_add_ps(_mm_loadu_ps(sums[c] + j), _mm_mul_ps(weight, _mm_loadu_ps(PlaneAt(args.input[c], args.step, row + k, j + l)))));
+		_mm_storeu_ps(sums[3] + j, _mm_add_ps(_mm_loadu_ps(sums[3] + j), weight));
+		for (int c = 0; c < 3; c++)
+			_mm_storeu_ps(scattered[c] + j, _mm_add_ps(_mm_loadu_ps(scattered[c] + j), _mm_mul_ps(weight, _mm_loadu_ps(PlaneAt(args.input[c], args.step, row, j)))));
+		_mm_storeu_ps(scattered[3] + j, _mm_add_ps(_mm_loadu_ps(scattered[3] + j), weight));
+	}
+	SymmetricBilateralOffsetScalar(args, row, k, l, sums, sumStep, j, colEnd);
+}
+
+/**
+ * @brief AVX2 symmetric bilateral kernel for one window offset. Processes eight pixel pairs per instruction
+ */
+template<bool UseLUT>
+__attribute__((target("avx2,fma")))
+static void SymmetricBilateralOffsetAVX2(const BilateralArgs &args, int row, int k, int l, float *const sums[4], std::size_t sumStep, int colBegin, int colEnd) {
+	const int padding = args.windowSize / 2;
+	const __m256 spatial = _mm256_set1_ps(args.spatialKernel[(padding + k) * args.windowSize + padding + l]);
+	const __m256 rangeFactor = _mm256_set1_ps(args.rangeFactor);
+	float *const scattered[4] = {sums[0] + (std::size_t) k * sumStep + l, sums[1] + (std::size_t) k * sumStep + l, sums[2] + (std::size_t) k * sumStep + l, sums[3] + (std::size_t) k * sumStep + l};
+
+	int j = colBegin;
+	for (; j + 8 <= colEnd; j += 8) {
+		__m256 distance = _mm256_setzero_ps();
+		for (int c = 0; c < 3; c++) {
+			__m256 difference = _mm256_sub_ps(_mm256_loadu_ps(PlaneAt(args.weighting[c], args.step, row, j)), _mm256_loadu_ps(PlaneAt(args.weighting[c], args.step, row + k, j + l)));
+			distance = _mm256_fmadd_ps(difference, difference, distance);
+		}
+		const __m256 weight = _mm256_mul_ps(spatial, RangeWeight256<UseLUT>(args.rangeLUT, distance, rangeFactor, _mm256_setzero_ps()));
+
+		// With k = 0 the scattered sums overlap the gathered ones, so each sum is stored before the next one is loaded
+		for (int c = 0; c < 3; c++)
+			_mm256_storeu_ps(sums[c] + j, _mm256_fmadd_ps(weight, _mm256_loadu_ps(PlaneAt(args.input[c], args.step, row + k, j + l)), _mm256_loadu_ps(sums[c] + j)));
+		_mm256_storeu_ps(sums[3] + j, _mm256_add_ps(_mm256_loadu_ps(sums[3] + j), weight));
+		for (int c = 0; c < 3; c++)
+			_mm256_storeu_ps(scattered[c] + j, _mm256_fmadd_ps(weight, _mm256_loadu_ps(PlaneAt(args.input[c], args.step, row, j)), _mm256_loadu_ps(scattered[c] + j)));
+		_mm256_storeu_ps(scattered[3] + j, _mm256_add_ps(_mm256_loadu_ps(scattered[3] + j), weight));
+	}
+	SymmetricBilateralOffsetScalar(args, row, k, l, sums, sumStep, j, colEnd);
+}
+
+/**
+ * @brief AVX-512 symmetric bilateral kernel for one window offset. Processes sixteen pixel pairs per instruction
+ */
+template<bool UseLUT>
+__attribute__((target("avx512f")))
+static void SymmetricBilateralOffsetAVX512(const BilateralArgs &args, int row, int k, int l, float *const sums[4], std::size_t sumStep, int colBegin, int colEnd) {
+	const int padding = args.windowSize / 2;
+	const __m512 spatial = _mm512_set1_ps(args.spatialKernel[(padding + k) * args.windowSize + padding + l]);
+	const __m512 rangeFactor = _mm512_set1_ps(args.rangeFactor);
+	float *const scattered[4] = {sums[0] + (std::size_t) k * sumStep + l, sums[1] + (std::size_t) k * sumStep + l, sums[2] + (std::size_t) k * sumStep + l, sums[3] + (std::size_t) k * sumStep + l};
+
+	int j = colBegin;
+	for (; j + 16 <= colEnd; j += 16) {
+		__m512 distance = _mm512_setzero_ps();
+		for (int c = 0; c < 3; c++) {
+			__m512 difference = _mm512_sub_ps(_mm512_loadu_ps(PlaneAt(args.weighting[c], args.step, row, j)), _mm512_loadu_ps(PlaneAt(args.weighting[c], args.step, row + k, j + l)));
+			distance = _mm512_fmadd_ps(difference, difference, distance);
+		}
+		const __m512 weight = _mm512_mul_ps(spatial, RangeWeight512<UseLUT>(args.rangeLUT, distance, rangeFactor, _mm512_setzero_ps()));
+
+		// With k = 0 the scattered sums overlap the gathered ones, so each sum is stored before the next one is loaded
+		for (int c = 0; c < 3; c++)
+			_mm512_storeu_ps(sums[c] + j, _mm512_fmadd_ps(weight, _mm512_loadu_ps(PlaneAt(args.input[c], args.step, row + k, j + l)), _mm512_loadu_ps(sums[c] + j)));
+		_mm512_storeu_ps(sums[3] + j, _mm512_add_ps(_mm512_loadu_ps(sums[3] + j), weight));
+		for (int c = 0; c < 3; c++)
+			_mm512_storeu_ps(scattered[c] + j, _mm512_fmadd_ps(weight, _mm512_loadu_ps(PlaneAt(args.input[c], args.step, row, j)), _mm512_loadu_ps(scattered[c] + j)));
+		_mm512_storeu_ps(scattered[3] + j, _mm512_add_ps(_mm512_loadu_ps(scattered[3] + j), weight));
+	}
+	SymmetricBilateralOffsetScalar(args, row, k, l, sums, sumStep, j, colEnd);
+}
+
+/**
+ * @brief SSE4 non local means weighting. Processes four window pixels per instruction
+ */
+template<int WS, bool UseLUT>
+__attribute__((target("sse4.1")))
+static void NonLocalMeansPixelSSE4(const NonLocalMeansArgs &args, const float *distances, int row, int col, float *output) {
+	const int windowSize = WS ? WS : args.windowSize;
+	const int padding = windowSize / 2;
+	const __m128 weightFactor = _mm_set1_ps(args.weightFactor);
+	const __m128 weightOffset = _mm_set1_ps(args.weightOffset);
+	__m128 norm = _mm_setzero_ps(), sumL = _mm_setzero_ps(), sumA = _mm_setzero_ps(), sumB = _mm_setzero_ps();
+	float tailNorm = 0.0f, tailL = 0.0f, tailA = 0.0f, tailB = 0.0f;
+	for (int k = 0; k < windowSize; k++) {
+		const float *iL = PlaneAt(args.input[0], args.step, row - padding + k, col - padding);
+		const float *iA = PlaneAt(args.input[1], args.step, row - padding + k, col - padding);
+		const float *iB = PlaneAt(args.input[2], args.step, row - padding + k, col - padding);
+		const float *distanceRow = distances + k * windowSize;
+		int l = 0;
+		#pragma GCC unroll 8
+		for (; l + 4 <= windowSize; l += 4) {
+			__m128 weight = RangeWeight128<UseLUT>(args.weightLUT, _mm_loadu_ps(distanceRow + l), weightFactor, weightOffset);
+			norm = _mm_add_ps(norm, weight);
+			sumL = _mm_add_ps(sumL, _mm_mul_ps(weight, _mm_loadu_ps(iL + l)));
+			sumA = _mm_add_ps(sumA, _mm_mul_ps(weight, _mm_loadu_ps(iA + l)));
+			sumB = _mm_add_ps(sumB, _mm_mul_ps(weight, _mm_loadu_ps(iB + l)));
+		}
+		for (; l < windowSize; l++) {
+			float weight = RangeWeight(args.weightLUT, distanceRow[l], args.weightFactor, args.weightOffset);
+			tailNorm += weight;
+			tailL += weight * iL[l];
+			tailA += weight * iA[l];
+			tailB += weight * iB[l];
+		}
+	}
+	float totalNorm = HorizontalSum128(norm) + tailNorm;
+	output[0] = (HorizontalSum128(sumL) + tailL) / totalNorm;
+	output[1] = (HorizontalSum128(sumA) + tailA) / totalNorm;
+	output[2] = (HorizontalSum128(sumB) + tailB) / totalNorm;
+}
+
+/**
+ * @brief AVX2 non local means weighting. Processes eight window pixels per instruction, masking the row tails
+ */
+template<int WS, bool UseLUT>
+__attribute__((target("avx2,fma")))
+static void NonLocalMeansPixelAVX2(const NonLocalMeansArgs &args, const float *distances, int row, int col, float *output) {
+	const int windowSize = WS ? WS : args.windowSize;
+	const int padding = windowSize / 2;
+	const __m256 weightFactor = _mm256_set1_ps(args.weightFactor);
+	const __m256 weightOffset = _mm256_set1_ps(args.weightOffset);
+	const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+	__m256 norm = _mm256_setzero_ps(), sumL = _mm256_setzero_ps(), sumA = _mm256_setzero_ps(), sumB = _mm256_setzero_ps();
+	for (int k = 0; k < windowSize; k++) {
+		const float *iL = PlaneAt(args.input[0], args.step, row - padding + k, col - padding);
+		const float *iA = PlaneAt(args.input[1], args.step, row - padding + k, col - padding);
+		const float *iB = PlaneAt(args.input[2], args.step, row - padding + k, col - padding);
+		const float *distanceRow = distances + k * windowSize;
+		#pragma GCC unroll 4
+		for (int l = 0; l < windowSize; l += 8) {
+			__m256i mask = _mm256_cmpgt_epi32(_mm256_set1_epi32(windowSize - l), lanes);
+			__m256 distance = _mm256_maskload_ps(distanceRow + l, mask);
+			__m256 weight = RangeWeight256<UseLUT>(args.weightLUT, distance, weightFactor, weightOffset);
+			weight = _mm256_and_ps(weight, _mm256_castsi256_ps(mask));
+			norm = _mm256_add_ps(norm, weight);
+			sumL = _mm256_fmadd_ps(weight, _mm256_maskload_ps(iL + l, mask), sumL);
+			sumA = _mm256_fmadd_ps(weight, _mm256_maskload_ps(iA + l, mask), sumA);
+			sumB = _mm256_fmadd_ps(weight, _mm256_maskload_ps(iB + l, mask), sumB);
+		}
+	}
+	float totalNorm = HorizontalSum256(norm);
+	output[0] = HorizontalSum256(sumL) / totalNorm;
+	output[1] = HorizontalSum256(sumA) / totalNorm;
+	output[2] = HorizontalSum256(sumB) / totalNorm;
+}
+
+/**
+ * @brief AVX-512 non local means weighting. Processes sixteen window pixels per instruction, masking the row tails
+ */
+template<int WS, bool UseLUT>
+__attribute__((target("avx512f")))
+static void NonLocalMeansPixelAVX512(const NonLocalMeansArgs &args, const float *distances, int row, int col, float *output) {
+	const int windowSize = WS ? WS : args.windowSize;
+	const int padding = windowSize / 2;
+	const __m512 weightFactor = _mm512_set1_ps(args.weightFactor);
+	const __m512 weightOffset = _mm512_set1_ps(args.weightOffset);
+	__m512 norm = _mm512_setzero_ps(), sumL = _mm512_setzero_ps(), sumA = _mm512_setzero_ps(), sumB = _mm512_setzero_ps();
+	for (int k = 0; k < windowSize; k++) {
+		const float *iL = PlaneAt(args.input[0], args.step, row - padding + k, col - padding);
+		const float *iA = PlaneAt(args.input[1], args.step, row - padding + k, col - padding);
+		const float *iB = PlaneAt(args.input[2], args.step, row - padding + k, col - padding);
+		const float *distanceRow = distances + k * windowSize;
+		#pragma GCC unroll 2
+		for (int l = 0; l < windowSize; l += 16) {
+			int remaining = windowSize - l;
+			__mmask16 mask = remaining >= 16 ? (__mmask16) 0xFFFF : (__mmask16) ((1u << remaining) - 1u);
+			__m512 distance = _mm512_maskz_loadu_ps(mask, distanceRow + l);
+			__m512 weight = _mm512_maskz_mov_ps(mask, RangeWeight512<UseLUT>(args.weightLUT, distance, weightFactor, weightOffset));
+			norm = _mm512_add_ps(norm, weight);
+			sumL = _mm512_fmadd_ps(weight, _mm512_maskz_loadu_ps(mask, iL + l), sumL);
+			sumA = _mm512_fmadd_ps(weight, _mm512_maskz_loadu_ps(mask, iA + l), sumA);
+			sumB = _mm512_fmadd_ps(weight, _mm512_maskz_loadu_ps(mask, iB + l), sumB);
+		}
+	}
+	float totalNorm = _mm512_reduce_add_ps(norm);
+	output[0] = _mm512_reduce_add_ps(sumL) / totalNorm;
+	output[1] = _mm512_reduce_add_ps(sumA) / totalNorm;
+	output[2] = _mm512_reduce_add_ps(sumB) / totalNorm;
+}
+
+/**
+ * @brief SSE4 patch distances. Compares two window columns per instruction in double precision, summing in the order
+ * of the scalar kernel. Only used for the specialized windows with patches no larger than the window
+ */
+template<int WS>
+__attribute__((target("sse4.1")))
+static void PatchDistancesSSE4(const float *const *window, std::size_t step, int, int neighborhoodSize, const unsigned char *candidates, float *distances) {
+	const int padding = WS / 2;
+	const int length = (WS + 1) / 2 * 2 + neighborhoodSize - 1;
+	alignas(64) float sliding[2 * PATCH_COLUMNS];
+	alignas(64) double sums[3][PATCH_COLUMNS];
+	for (int i = 0; i < WS; i++) {
+		if (DiscardedRow(candidates ? candidates + i * WS : nullptr, WS)) {
+			std::fill(distances + i * WS, distances + (i + 1) * WS, FLT_MAX);
+			continue;
+		}
+		for (int c = 0; c < 3; c++) {
+			std::fill(sums[c], sums[c] + PATCH_COLUMNS, 0.0);
+			for (int k = 0; k < neighborhoodSize; k++) {
+				const float *fixedRow = PlaneAt(window[c], step, k, 0);
+				ReplicateRow(PlaneAt(window[c], step, std::min(std::max(i - padding + k, 0), WS - 1), 0), WS, length, sliding);
+				for (int j = 0; j < WS; j += 2) {
+					__m128d sum = _mm_loadu_pd(sums[c] + j);
+					for (int l = 0; l < neighborhoodSize; l++) {
+						__m128d difference = _mm_sub_pd(_mm_set1_pd((double) fixedRow[l]), _mm_cvtps_pd(_mm_castsi128_ps(_mm_loadl_epi64((const __m128i *) (sliding + j + l)))));
+						sum = _mm_add_pd(sum, _mm_mul_pd(difference, difference));
+					}
+					_mm_storeu_pd(sums[c] + j, sum);
+				}
+			}
+		}
+		StorePatchDistanceRow(sums, WS, neighborhoodSize, candidates ? candidates + i * WS : nullptr, distances + i * WS);
+	}
+}
+
+/**
+ * @brief AVX2 patch distances. Compares four window columns per instruction in double precision, summing in the order
+ * of the scalar kernel. Only used for the specialized windows with patches no larger than the window
+ */
+template<int WS>
+__attribute__((target("avx2,fma")))
+static void PatchDistancesAVX2(const float *const *window, std::size_t step, int, int neighborhoodSize, const unsigned char *candidates, float *distances) {
+	const int padding = WS / 2;
+	const int length = (WS + 3) / 4 * 4 + neighborhoodSize - 1;
+	alignas(64) float sliding[2 * PATCH_COLUMNS];
+	alignas(64) double sums[3][PATCH_COLUMNS];
+	for (int i = 0; i < WS; i++) {
+		if (DiscardedRow(candidates ? candidates + i * WS : nullptr, WS)) {
+			std::fill(distances + i * WS, distances + (i + 1) * WS, FLT_MAX);
+			continue;
+		}
+		for (int c = 0; c < 3; c++) {
+			std::fill(sums[c], sums[c] + PATCH_COLUMNS, 0.0);
+			for (int k = 0; k < neighborhoodSize; k++) {
+				const float *fixedRow = PlaneAt(window[c], step, k, 0);
+				ReplicateRow(PlaneAt(window[c], step, std::min(std::max(i - padding + k, 0), WS - 1), 0), WS, length, sliding);
+				for (int j = 0; j < WS; j += 4) {
+					__m256d sum = _mm256_loadu_pd(sums[c] + j);
+					for (int l = 0; l < neighborhoodSize; l++) {
+						__m256d difference = _mm256_sub_pd(_mm256_set1_pd((double) fixedRow[l]), _mm256_cvtps_pd(_mm_loadu_ps(sliding + j + l)));
+						sum = _mm256_add_pd(sum, _mm256_mul_pd(difference, difference));
+					}
+					_mm256_storeu_pd(sums[c] + j, sum);
+				}
+			}
+		}
+		StorePatchDistanceRow(sums, WS, neighborhoodSize, candidates ? candidates + i * WS : nullptr, distances + i * WS);
+	}
+}
+
+/**
+ * @brief AVX-512 patch distances. Compares eight window columns per instruction in double precision, summing in the order
+ * of the scalar kernel. Only used for the specialized windows with patches no larger than the window
+ */
+template<int WS>
+__attribute__((target("avx512f")))
+static void PatchDistancesAVX512(const float *const *window, std::size_t step, int, int neighborhoodSize, const unsigned char *candidates, float *distances) {
+	const int padding = WS / 2;
+	const int length = (WS + 7) / 8 * 8 + neighborhoodSize - 1;
+	alignas(64) float sliding[2 * PATCH_COLUMNS];
+	alignas(64) double sums[3][PATCH_COLUMNS];
+	for (int i = 0; i < WS; i++) {
+		if (DiscardedRow(candidates ? candidates + i * WS : nullptr, WS)) {
+			std::fill(distances + i * WS, distances + (i + 1) * WS, FLT_MAX);
+			continue;
+		}
+		for (int c = 0; c < 3; c++) {
+			std::fill(sums[c], sums[c] + PATCH_COLUMNS, 0.0);
+			for (int k = 0; k < neighborhoodSize; k++) {
+				const float *fixedRow = PlaneAt(window[c], step, k, 0);
+				ReplicateRow(PlaneAt(window[c], step, std::min(std::max(i - padding + k, 0), WS - 1), 0), WS, length, sliding);
+				for (int j = 0; j < WS; j += 8) {
+					__m512d sum = _mm512_loadu_pd(sums[c] + j);
+					for (int l = 0; l < neighborhoodSize; l++) {
+						__m512d difference = _mm512_sub_pd(_mm512_set1_pd((double) fixedRow[l]), _mm512_cvtps_pd(_mm256_loadu_ps(sliding + j + l)));
+						sum = _mm512_add_pd(sum, _mm512_mul_pd(difference, difference));
+					}
+					_mm512_storeu_pd(sums[c] + j, sum);
+				}
+			}
+		}
+		StorePatchDistanceRow(sums, WS, neighborhoodSize, candidates ? candidates + i * WS : nullptr, distances + i * WS);
+	}
+}
+
+#pragma GCC diagnostic pop
+
+#endif /* KERNELS_X86 */
+
+/**
+ * @brief Resolves a kernel specialized for the window size. Every odd size in
+ * [MIN_SPECIALIZED_WINDOW, MAX_SPECIALIZED_WINDOW] has its own instantiation with a compile time window,
+ * so the loop trip counts, masks and kernel offsets are constants. Other sizes get the generic kernel (WS = 0)
+ *
+ * @param windowSize processing window size
+ * @param select template lambda returning the kernel for a window size
+ * @return kernel returned by select
+ */
+template<int WS = Kernels::MIN_SPECIALIZED_WINDOW, typename Select>
+static inline auto SpecializeWindow(int windowSize, const Select &select) {
+	if constexpr (WS > Kernels::MAX_SPECIALIZED_WINDOW) return select.template operator()<0>();
+	else return windowSize == WS ? select.template operator()<WS>() : SpecializeWindow<WS + 2>(windowSize, select);
+}
+
+/**
+ * @brief Detects the widest supported instruction set through CPUID. AVX2 is only used together with FMA
+ *
+ * @return ISA detected instruction set
+ */
+Kernels::ISA Kernels::DetectISA() {
+#ifdef KERNELS_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f")) return AVX512;
+	if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return AVX2;
+	if (__builtin_cpu_supports("sse4.1")) return SSE4;
+#endif
+	return SCALAR;
+}
+
+/**
+ * @brief Gets the instruction set used by the kernels
+ *
+ * @return ISA active instruction set
+ */
+Kernels::ISA Kernels::ActiveISA() {
+	return activeISA;
+}
+
+/**
+ * @brief Overrides the instruction set used by the kernels
+ *
+ * @param isa desired instruction set
+ * @return true if the processor supports the instruction set
+ * @return false if it is not supported, the active instruction set is kept
+ */
+bool Kernels::SetISA(ISA isa) {
+	if (isa > DetectISA()) return false;
+	activeISA = isa;
+	return true;
+}
+
+/**
+ * @brief Converts an instruction set name into its identifier
+ *
+ * @param name instruction set name: scalar, sse4, avx2 or avx512
+ * @param isa instruction set identifier
+ * @return true if the name is valid
+ */
+bool Kernels::ParseISA(const std::string &name, ISA &isa) {
+	for (ISA candidate : {SCALAR, SSE4, AVX2, AVX512}) {
+		if (name == ISAName(candidate)) {
+			isa = candidate;
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * @brief Gets the name of an instruction set
+ *
+ * @param isa instruction set identifier
+ * @return std::string instruction set name
+ */
+std::string Kernels::ISAName(ISA isa) {
+	switch (isa) {
+		case SSE4: return "sse4";
+		case AVX2: return "avx2";
+		case AVX512: return "avx512";
+		default: return "scalar";
+	}
+}
+
+/**
+ * @brief Applies the bilateral filter to a range of columns of an output row. The pixels whose windows stay
+ * inside of the image run through the vectorized kernels without bound checks, only the border strip of
+ * windowSize / 2 pixels is evaluated with checked indexing
+ *
+ * @param args kernel arguments
+ * @param row output row
+ * @param colBegin first output column
+ * @param colEnd last output column (excluded)
+ */
+void Kernels::BilateralRow(const BilateralArgs &args, int row, int colBegin, int colEnd) {
+	const int padding = args.windowSize / 2;
+
+	// Rows whose windows cross the top or bottom border
+	if (row < padding || row >= args.rows - padding) {
+		for (int j = colBegin; j < colEnd; j++) BilateralPixelBorder(args, row, j);
+		return;
+	}
+
+	// Columns whose windows cross the left or right border
+	const int interiorBegin = std::min(std::max(colBegin, padding), colEnd);
+	const int interiorEnd = std::max(interiorBegin, std::min(colEnd, args.cols - padding));
+	for (int j = colBegin; j < interiorBegin; j++) BilateralPixelBorder(args, row, j);
+	for (int j = interiorEnd; j < colEnd; j++) BilateralPixelBorder(args, row, j);
+	if (interiorBegin == interiorEnd) return;
+
+	using Kernel = void (*)(const BilateralArgs &, int, int, int);
+	Kernel kernel = SpecializeWindow(args.windowSize, [&]<int WS>() -> Kernel {
+		switch (activeISA) {
+#ifdef KERNELS_X86
+			case AVX512: return args.rangeLUT ? BilateralRowAVX512<WS, true> : BilateralRowAVX512<WS, false>;
+			case AVX2: return args.rangeLUT ? BilateralRowAVX2<WS, true> : BilateralRowAVX2<WS, false>;
+			case SSE4: return args.rangeLUT ? BilateralRowSSE4<WS, true> : BilateralRowSSE4<WS, false>;
+#endif
+			default: return BilateralRowScalar<WS>;
+		}
+	});
+	kernel(args, row, interiorBegin, interiorEnd);
+}
+
+/**
+ * @brief Accumulates the symmetric bilateral filter pairs of an image row. Each pixel evaluates the window offsets
+ * after it in raster order, one offset at a time along the row, and accumulates every pair into its own sums and
+ * into the ones of the other pixel, which are in the windowSize / 2 rows below. The sums are not normalized, the
+ * pixels whose windows cross the image border also get the weight of the zeros outside of it in their norm
+ *
+ * @param args kernel arguments, the output is not used
+ * @param row image row
+ * @param sums accumulator rows of the L, a, b sums and the norm for the image row, with the windowSize / 2
+ * following rows after them, or up to the last image row
+ * @param sumStep distance in floats between two consecutive accumulator rows
+ */
+void Kernels::SymmetricBilateralRow(const BilateralArgs &args, int row, float *const sums[4], std::size_t sumStep) {
+	const int padding = args.windowSize / 2;
+
+	// The pixel with itself, the range weight is one
+	const float center = args.spatialKernel[padding * args.windowSize + padding];
+	for (int c = 0; c < 3; c++) {
+		const float *input = PlaneAt(args.input[c], args.step, row, 0);
+		for (int j = 0; j < args.cols; j++) sums[c][j] += center * input[j];
+	}
+	for (int j = 0; j < args.cols; j++) sums[3][j] += center;
+
+	using Kernel = void (*)(const BilateralArgs &, int, int, int, float *const *, std::size_t, int, int);
+	Kernel kernel = SymmetricBilateralOffsetScalar;
+	switch (activeISA) {
+#ifdef KERNELS_X86
+		case AVX512: kernel = args.rangeLUT ? SymmetricBilateralOffsetAVX512<true> : SymmetricBilateralOffsetAVX512<false>; break;
+		case AVX2: kernel = args.rangeLUT ? SymmetricBilateralOffsetAVX2<true> : SymmetricBilateralOffsetAVX2<false>; break;
+		case SSE4: kernel = args.rangeLUT ? SymmetricBilateralOffsetSSE4<true> : SymmetricBilateralOffsetSSE4<false>; break;
+#endif
+		default: break;
+	}
+
+	// Offsets after the pixel, each one over the columns whose pair stays inside of the image
+	for (int k = 0; k <= padding && row + k < args.rows; k++) {
+		for (int l = (k == 0 ? 1 : -padding); l <= padding; l++)
+			kernel(args, row, k, l, sums, sumStep, std::max(0, -l), std::min(args.cols, args.cols - l));
+	}
+
+	// Border pixels
+	const bool borderRow = row < padding || row >= args.rows - padding;
+	for (int j = 0; j < args.cols; j++) {
+		if (borderRow || j < padding || j >= args.cols - padding) SymmetricBilateralOutside(args, row, j, sums[3][j]);
+	}
+}
+
+/**
+ * @brief Computes the non local means weights from the patch distances of a window and applies them to the input.
+ * Pixels in the border strip of windowSize / 2 pixels are evaluated with checked indexing
+ *
+ * @param args kernel arguments
+ * @param distances continuous windowSize x windowSize patch distances
+ * @param row output row, the window center
+ * @param col output column, the window center
+ * @param output three output channel values
+ */
+void Kernels::NonLocalMeansPixel(const NonLocalMeansArgs &args, const float *distances, int row, int col, float *output) {
+	const int padding = args.windowSize / 2;
+	if (row < padding || row >= args.rows - padding || col < padding || col >= args.cols - padding) {
+		NonLocalMeansPixelBorder(args, distances, row, col, output);
+		return;
+	}
+
+	using Kernel = void (*)(const NonLocalMeansArgs &, const float *, int, int, float *);
+	Kernel kernel = SpecializeWindow(args.windowSize, [&]<int WS>() -> Kernel {
+		switch (activeISA) {
+#ifdef KERNELS_X86
+			case AVX512: return args.weightLUT ? NonLocalMeansPixelAVX512<WS, true> : NonLocalMeansPixelAVX512<WS, false>;
+			case AVX2: return args.weightLUT ? NonLocalMeansPixelAVX2<WS, true> : NonLocalMeansPixelAVX2<WS, false>;
+			case SSE4: return args.weightLUT ? NonLocalMeansPixelSSE4<WS, true> : NonLocalMeansPixelSSE4<WS, false>;
+#endif
+			default: return NonLocalMeansPixelScalar<WS>;
+		}
+	});
+	kernel(args, distances, row, col, output);
+}
+
+/**
+ * @brief Computes the CIELab patch distances of a processing window for the non local means filter
+ *
+ * @param window three plane addresses of the window's first pixel
+ * @param step plane row step in floats
+ * @param windowSize processing window size
+ * @param neighborhoodSize patch size
+ * @param candidates windowSize x windowSize flags of the patches to compare, the others get the largest distance. Can be null
+ * @param distances continuous windowSize x windowSize output distances
+ */
+void Kernels::PatchDistances(const float *const window[3], std::size_t step, int windowSize, int neighborhoodSize, const unsigned char *candidates, float *distances) {
+	using Kernel = void (*)(const float *const *, std::size_t, int, int, const unsigned char *, float *);
+	Kernel kernel = SpecializeWindow(windowSize, [&]<int WS>() -> Kernel {
+		if constexpr (WS == 0) return PatchDistancesScalar<WS>;
+		else {
+			if (neighborhoodSize > WS) return PatchDistancesScalar<WS>;
+			switch (activeISA) {
+#ifdef KERNELS_X86
+				case AVX512: return PatchDistancesAVX512<WS>;
+				case AVX2: return PatchDistancesAVX2<WS>;
+				case SSE4: return PatchDistancesSSE4<WS>;
+#endif
+				default: return PatchDistancesScalar<WS>;
+			}
+		}
+	});
+	kernel(window, step, windowSize, neighborhoodSize, candidates, distances);
+}
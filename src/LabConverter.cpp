@@ -0,0 +1,198 @@
+#include "LabConverter.hpp"
+
+#include <cmath>
+#include <algorithm>
+
+// sRGB (D65) to XYZ matrix, white point and Lab constants of the OpenCV conversion
+static const double RGB_TO_XYZ[3][3] = {
+	{0.412453, 0.357580, 0.180423},
+	{0.212671, 0.715160, 0.072169},
+	{0.019334, 0.119193, 0.950227}
+};
+static const float XYZ_TO_RGB[3][3] = {
+	{ 3.240479f, -1.53715f,  -0.498535f},
+	{-0.969256f,  1.875991f,  0.041556f},
+	{ 0.055648f, -0.204043f,  1.057311f}
+};
+static const double WHITE[3] = {0.950456, 1.0, 1.088754};
+static const float LAB_THRESHOLD = 0.008856f;	// XYZ value where the cube root starts
+static const float LAB_SLOPE = 7.787f;			// Slope of the linear part
+static const float LAB_OFFSET = 16.0f / 116.0f;	// Offset of the linear part
+static const float F_THRESHOLD = LAB_SLOPE * LAB_THRESHOLD + LAB_OFFSET; // Nonlinearity value at the threshold
+
+/**
+ * @brief Conversion tables, built once on first use
+ *
+ */
+struct LabConverter::Tables {
+	float xyz[3][3][256];	// Normalized XYZ contribution of each B, G and R value
+	float nonlinearity[SIZE + 2];	// Lab nonlinearity on [0, 1]
+	float gamma[SIZE + 2];			// sRGB gamma times 255 on [0, 1]
+
+	Tables() {
+		for (int v = 0; v < 256; v++) {
+			const double c = v / 255.0;
+			const double linear = c <= 0.04045 ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4);
+			// BGR order of the frames, the matrix columns are in RGB order
+			for (int x = 0; x < 3; x++)
+				for (int channel = 0; channel < 3; channel++)
+					xyz[x][channel][v] = (float) (RGB_TO_XYZ[x][2 - channel] * linear / WHITE[x]);
+		}
+		for (int i = 0; i <= SIZE + 1; i++) {
+			const double t = (double) i / SIZE;
+			nonlinearity[i] = (float) (t > LAB_THRESHOLD ? std::cbrt(t) : LAB_SLOPE * t + LAB_OFFSET);
+			gamma[i] = (float) (255.0 * (t <= 0.0031308 ? 12.92 * t : 1.055 * std::pow(t, 1.0 / 2.4) - 0.055));
+		}
+	}
+};
+
+/**
+ * @brief Gets the conversion tables, the first call builds them
+ *
+ * @return const LabConverter::Tables& conversion tables
+ */
+const LabConverter::Tables &LabConverter::GetTables() {
+	static const Tables tables;
+	return tables;
+}
+
+/**
+ * @brief Linear interpolation in a table of SIZE intervals on [0, 1]
+ *
+ * @param table table entries
+ * @param t position in [0, 1]
+ * @return float interpolated value
+ */
+static inline float Interpolate(const float *table, float t) {
+	const float x = t * (float) LabConverter::SIZE;
+	const int i = std::min((int) x, LabConverter::SIZE - 1);
+	return table[i] + (x - (float) i) * (table[i + 1] - table[i]);
+}
+
+/**
+ * @brief Converts a row of 8 bit BGR or grayscale pixels to CIELab
+ *
+ * @param tables conversion tables
+ * @param bgr first pixel of the row
+ * @param channels 3 for BGR or 1 for grayscale
+ * @param cols pixels in the row
+ * @param lab first L, a and b values of the output row
+ * @param stride distance in floats between two consecutive output pixels
+ */
+void LabConverter::BGRToLabRow(const Tables &tables, const uchar *bgr, int channels, int cols, float *const lab[3], int stride) {
+	const int greenOffset = channels == 3 ? 1 : 0, redOffset = channels == 3 ? 2 : 0;
+	for (int j = 0; j < cols; j++) {
+		const uchar *pixel = bgr + j * channels;
+		float f[3];
+		for (int x = 0; x < 3; x++) {
+			const float value = tables.xyz[x][0][pixel[0]] + tables.xyz[x][1][pixel[greenOffset]] + tables.xyz[x][2][pixel[redOffset]];
+			f[x] = Interpolate(tables.nonlinearity, value);
+		}
+		const std::size_t k = (std::size_t) j * (std::size_t) stride;
+		lab[0][k] = 116.0f * f[1] - 16.0f;
+		lab[1][k] = 500.0f * (f[0] - f[1]);
+		lab[2][k] = 200.0f * (f[1] - f[2]);
+	}
+}
+
+/**
+ * @brief Converts a row of CIELab pixels to 8 bit BGR, rounding and saturating the values
+ *
+ * @param tables conversion tables
+ * @param lab first L, a and b values of the input row
+ * @param stride distance in floats between two consecutive input pixels
+ * @param cols pixels in the row
+ * @param bgr first pixel of the output row
+ */
+void LabConverter::LabToBGRRow(const Tables &tables, const float *const lab[3], int stride, int cols, uchar *bgr) {
+	for (int j = 0; j < cols; j++) {
+		const std::size_t k = (std::size_t) j * (std::size_t) stride;
+		const float fy = (lab[0][k] + 16.0f) / 116.0f;
+		float f[3] = {fy + lab[1][k] / 500.0f, fy, fy - lab[2][k] / 200.0f};
+		float xyz[3];
+		for (int x = 0; x < 3; x++) {
+			const float value = f[x] > F_THRESHOLD ? f[x] * f[x] * f[x] : (f[x] - LAB_OFFSET) / LAB_SLOPE;
+			xyz[x] = value * (float) WHITE[x];
+		}
+		for (int channel = 0; channel < 3; channel++) {
+			const float *m = XYZ_TO_RGB[2 - channel];
+			const float linear = std::clamp(m[0] * xyz[0] + m[1] * xyz[1] + m[2] * xyz[2], 0.0f, 1.0f);
+			bgr[3 * j + channel] = (uchar) (Interpolate(tables.gamma, linear) + 0.5f);
+		}
+	}
+}
+
+/**
+ * @brief Converts an 8 bit BGR or grayscale frame to an interleaved CIELab image. Grayscale pixels are taken as
+ * BGR pixels with three equal values
+ *
+ * @param bgr CV_8UC3 or CV_8UC1 frame
+ * @param lab CV_32FC3 CIELab image, allocated if it does not match the frame
+ */
+void LabConverter::BGRToLab(const Mat &bgr, Mat &lab) {
+	CV_Assert(bgr.depth() == CV_8U && (bgr.channels() == 3 || bgr.channels() == 1));
+	lab.create(bgr.size(), CV_32FC3);
+	const Tables &tables = GetTables();
+
+	#pragma omp parallel for shared(bgr, lab, tables)
+	for (int i = 0; i < bgr.rows; i++) {
+		float *row = lab.ptr<float>(i);
+		float *const channels[3] = {row, row + 1, row + 2};
+		BGRToLabRow(tables, bgr.ptr<uchar>(i), bgr.channels(), bgr.cols, channels, 3);
+	}
+}
+
+/**
+ * @brief Converts an 8 bit BGR or grayscale frame to three CIELab planes
+ *
+ * @param bgr CV_8UC3 or CV_8UC1 frame
+ * @param planes CV_32FC1 L, a and b planes, allocated if they do not match the frame
+ */
+void LabConverter::BGRToLab(const Mat &bgr, Mat planes[3]) {
+	CV_Assert(bgr.depth() == CV_8U && (bgr.channels() == 3 || bgr.channels() == 1));
+	for (int c = 0; c < 3; c++) planes[c].create(bgr.size(), CV_32FC1);
+	const Tables &tables = GetTables();
+
+	#pragma omp parallel for shared(bgr, planes, tables)
+	for (int i = 0; i < bgr.rows; i++) {
+		float *const channels[3] = {planes[0].ptr<float>(i), planes[1].ptr<float>(i), planes[2].ptr<float>(i)};
+		BGRToLabRow(tables, bgr.ptr<uchar>(i), bgr.channels(), bgr.cols, channels, 1);
+	}
+}
+
+/**
+ * @brief Converts an interleaved CIELab image to an 8 bit BGR frame
+ *
+ * @param lab CV_32FC3 CIELab image
+ * @param bgr CV_8UC3 frame, allocated if it does not match the image
+ */
+void LabConverter::LabToBGR(const Mat &lab, Mat &bgr) {
+	CV_Assert(lab.type() == CV_32FC3);
+	bgr.create(lab.size(), CV_8UC3);
+	const Tables &tables = GetTables();
+
+	#pragma omp parallel for shared(lab, bgr, tables)
+	for (int i = 0; i < lab.rows; i++) {
+		const float *row = lab.ptr<float>(i);
+		const float *const channels[3] = {row, row + 1, row + 2};
+		LabToBGRRow(tables, channels, 3, lab.cols, bgr.ptr<uchar>(i));
+	}
+}
+
+/**
+ * @brief Converts three CIELab planes to an 8 bit BGR frame
+ *
+ * @param planes CV_32FC1 L, a and b planes
+ * @param bgr CV_8UC3 frame, allocated if it does not match the planes
+ */
+void LabConverter::LabToBGR(const Mat planes[3], Mat &bgr) {
+	CV_Assert(planes[0].type() == CV_32FC1 && planes[1].size() == planes[0].size() && planes[2].size() == planes[0].size());
+	bgr.create(planes[0].size(), CV_8UC3);
+	const Tables &tables = GetTables();
+
+	#pragma omp parallel for shared(planes, bgr, tables)
+	for (int i = 0; i < bgr.rows; i++) {
+		const float *const channels[3] = {planes[0].ptr<float>(i), planes[1].ptr<float>(i), planes[2].ptr<float>(i)};
+		LabToBGRRow(tables, channels, 1, bgr.cols, bgr.ptr<uchar>(i));
+	}
+}
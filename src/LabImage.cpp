@@ -0,0 +1,109 @@
+#include "LabImage.hpp"
+
+/**
+ * @brief LabImage class constructor. Starts without planes
+ *
+ */
+LabImage::LabImage() {}
+
+/**
+ * @brief Allocates an image with padded planes, their values are undefined
+ *
+ * @param size image size
+ */
+LabImage::LabImage(Size size) {
+	const Mat buffers[3] = {
+		Mat(size.height, PaddedCols(size.width), CV_32FC1),
+		Mat(size.height, PaddedCols(size.width), CV_32FC1),
+		Mat(size.height, PaddedCols(size.width), CV_32FC1)
+	};
+	*this = LabImage(buffers, size);
+}
+
+/**
+ * @brief Builds an image over three padded buffers, such as the ones of a workspace. The padding columns are
+ * cleared, so they stay at zero for as long as the image is only written through its planes
+ *
+ * @param buffers CV_32FC1 buffers of size.height rows and PaddedCols(size.width) columns, shared with the image
+ * @param size image size
+ */
+LabImage::LabImage(const Mat buffers[3], Size size) {
+	for (int c = 0; c < 3; c++) {
+		CV_Assert(buffers[c].type() == CV_32FC1 && buffers[c].rows == size.height && buffers[c].cols == PaddedCols(size.width));
+		if (buffers[c].cols > size.width) buffers[c].colRange(size.width, buffers[c].cols).setTo(Scalar::all(0));
+		planes[c] = buffers[c].colRange(0, size.width);
+	}
+}
+
+/**
+ * @brief Gets the buffer columns of a plane, the columns rounded up to a whole number of aligned blocks
+ *
+ * @param cols image columns
+ * @return int padded columns
+ */
+int LabImage::PaddedCols(int cols) {
+	const int block = ALIGNMENT / (int) sizeof(float);
+	return (cols + block - 1) / block * block;
+}
+
+/**
+ * @brief Gets the size of the image
+ *
+ * @return Size image size
+ */
+Size LabImage::ImageSize() const {
+	return planes[0].size();
+}
+
+/**
+ * @brief Gets the row step of the planes
+ *
+ * @return std::size_t distance in floats between two consecutive rows of a plane
+ */
+std::size_t LabImage::Step() const {
+	return planes[0].step1();
+}
+
+/**
+ * @brief Checks whether the image has planes
+ *
+ * @return true if the image has no planes
+ */
+bool LabImage::Empty() const {
+	return planes[0].empty();
+}
+
+/**
+ * @brief Gets a region of the image, sharing its planes. The neighbours of the region are image values, so the
+ * OpenCV filters that read past a view see them instead of their border, a Clone of the region is isolated
+ *
+ * @param region region inside of the image
+ * @return LabImage view of the region
+ */
+LabImage LabImage::Crop(const Rect &region) const {
+	LabImage crop;
+	for (int c = 0; c < 3; c++) crop.planes[c] = planes[c](region);
+	return crop;
+}
+
+/**
+ * @brief Copies the image into new padded planes
+ *
+ * @return LabImage copy of the image
+ */
+LabImage LabImage::Clone() const {
+	LabImage copy(ImageSize());
+	CopyTo(copy);
+	return copy;
+}
+
+/**
+ * @brief Copies the image into another one, which gets new padded planes if its size differs. A destination of
+ * the same size, such as a Crop, is written in place
+ *
+ * @param destination destination image
+ */
+void LabImage::CopyTo(LabImage &destination) const {
+	if (destination.Empty() || destination.ImageSize() != ImageSize()) destination = LabImage(ImageSize());
+	for (int c = 0; c < 3; c++) planes[c].copyTo(destination.planes[c]);
+}
@@ -0,0 +1,290 @@
+#include "PermutohedralLattice.hpp"
+
+#include <cmath>
+#include <algorithm>
+
+/**
+ * @brief PermutohedralLattice class constructor. Starts empty at full resolution
+ *
+ */
+PermutohedralLattice::PermutohedralLattice(): PermutohedralLattice(0, 1.0f) {}
+
+/**
+ * @brief PermutohedralLattice class constructor. Prepares the position scaling and the canonical simplex
+ *
+ * @param pixels number of positions that will be splatted, used to size the hash table
+ * @param resolution lattice points per standard deviation, in the interval (0, 1]
+ */
+PermutohedralLattice::PermutohedralLattice(std::size_t pixels, float resolution) {
+	Reset(pixels, resolution);
+}
+
+/**
+ * @brief Empties the lattice and prepares the position scaling and the canonical simplex. The tables keep their
+ * capacity, so they only grow when the new image needs more lattice points than the previous ones
+ *
+ * @param pixels number of positions that will be splatted, used to size the hash table
+ * @param resolution lattice points per standard deviation, in the interval (0, 1]
+ */
+void PermutohedralLattice::Reset(std::size_t pixels, float resolution) {
+	this->resolution = resolution;
+	points = 0;
+
+	// A single blur along every lattice direction matches a Gaussian of this inverse standard deviation
+	const double inverseDeviation = (D + 1) * std::sqrt(2.0 / 3.0) * resolution;
+	for (int i = 0; i < D; i++)
+		scaleFactor[i] = (float) (inverseDeviation / std::sqrt((double) ((i + 1) * (i + 2))));
+
+	// Vertices of the canonical simplex, one per remainder
+	for (int i = 0; i <= D; i++) {
+		for (int j = 0; j <= D - i; j++) canonical[i * (D + 1) + j] = i;
+		for (int j = D - i + 1; j <= D; j++) canonical[i * (D + 1) + j] = i - (D + 1);
+	}
+
+	// Start with a slot per splatted pixel, rounded up to a power of two
+	std::size_t capacity = 1024;
+	while (capacity < pixels) capacity *= 2;
+	slots.assign(capacity, -1);
+	keys.clear();
+	values.clear();
+	keys.reserve(capacity / 2 * D);
+	values.reserve(capacity / 2 * VD);
+}
+
+/**
+ * @brief Finds the simplex enclosing a position and the barycentric weights of its vertices
+ *
+ * @param position D position coordinates
+ * @param vertexKeys (D + 1) x D vertex keys
+ * @param barycentric D + 2 barycentric weights, only the first D + 1 are used
+ */
+void PermutohedralLattice::Embed(const float *position, int *vertexKeys, float *barycentric) const {
+	double elevated[D + 1];
+	int greedy[D + 1], rank[D + 1];
+
+	// Elevate the position onto the hyperplane of the lattice
+	double sum = 0.0;
+	for (int i = D; i > 0; i--) {
+		double coordinate = (double) position[i - 1] * (double) scaleFactor[i - 1];
+		elevated[i] = sum - i * coordinate;
+		sum += coordinate;
+	}
+	elevated[0] = sum;
+
+	// Closest remainder zero lattice point
+	int coordinateSum = 0;
+	for (int i = 0; i <= D; i++) {
+		double scaled = elevated[i] / (D + 1);
+		int up = (int) std::ceil(scaled) * (D + 1);
+		int down = (int) std::floor(scaled) * (D + 1);
+		greedy[i] = (up - elevated[i] < elevated[i] - down) ? up : down;
+		coordinateSum += greedy[i];
+	}
+	coordinateSum /= D + 1;
+
+	// Rank the differential to that point
+	std::fill(rank, rank + D + 1, 0);
+	for (int i = 0; i < D; i++) {
+		for (int j = i + 1; j <= D; j++) {
+			if (elevated[i] - greedy[i] < elevated[j] - greedy[j]) rank[i]++;
+			else rank[j]++;
+		}
+	}
+
+	// Move the point back onto the hyperplane if its coordinates do not add up to zero
+	if (coordinateSum > 0) {
+		for (int i = 0; i <= D; i++) {
+			if (rank[i] >= D + 1 - coordinateSum) {
+				greedy[i] -= D + 1;
+				rank[i] += coordinateSum - (D + 1);
+			}
+			else rank[i] += coordinateSum;
+		}
+	}
+	else if (coordinateSum < 0) {
+		for (int i = 0; i <= D; i++) {
+			if (rank[i] < -coordinateSum) {
+				greedy[i] += D + 1;
+				rank[i] += (D + 1) + coordinateSum;
+			}
+			else rank[i] += coordinateSum;
+		}
+	}
+
+	// Barycentric coordinates of the position in the simplex
+	std::fill(barycentric, barycentric + D + 2, 0.0f);
+	for (int i = 0; i <= D; i++) {
+		float delta = (float) ((elevated[i] - greedy[i]) / (D + 1));
+		barycentric[D - rank[i]] += delta;
+		barycentric[D + 1 - rank[i]] -= delta;
+	}
+	barycentric[0] += 1.0f + barycentric[D + 1];
+
+	// Keys of the simplex vertices, the last coordinate is implied by the hyperplane
+	for (int remainder = 0; remainder <= D; remainder++)
+		for (int i = 0; i < D; i++)
+			vertexKeys[remainder * D + i] = greedy[i] + canonical[remainder * (D + 1) + rank[i]];
+}
+
+/**
+ * @brief Hashes a lattice key
+ *
+ * @param key D key coordinates
+ * @return std::size_t hash value
+ */
+std::size_t PermutohedralLattice::Hash(const int *key) const {
+	std::size_t hash = 0;
+	for (int i = 0; i < D; i++) {
+		hash += (std::size_t) (unsigned int) key[i];
+		hash *= 2531011;
+	}
+	return hash;
+}
+
+/**
+ * @brief Looks up a lattice point
+ *
+ * @param key D key coordinates
+ * @return int lattice point index, -1 if the point does not exist
+ */
+int PermutohedralLattice::Find(const int *key) const {
+	const std::size_t mask = slots.size() - 1;
+	for (std::size_t slot = Hash(key) & mask;; slot = (slot + 1) & mask) {
+		int point = slots[slot];
+		if (point < 0) return -1;
+		if (std::equal(key, key + D, keys.begin() + (std::ptrdiff_t) ((std::size_t) point * D))) return point;
+	}
+}
+
+/**
+ * @brief Looks up a lattice point and creates it with zero values if it does not exist
+ *
+ * @param key D key coordinates
+ * @return int lattice point index
+ */
+int PermutohedralLattice::Insert(const int *key) {
+	if (2 * (points + 1) > slots.size()) Grow();
+
+	const std::size_t mask = slots.size() - 1;
+	std::size_t slot = Hash(key) & mask;
+	for (;; slot = (slot + 1) & mask) {
+		int point = slots[slot];
+		if (point < 0) break;
+		if (std::equal(key, key + D, keys.begin() + (std::ptrdiff_t) ((std::size_t) point * D))) return point;
+	}
+
+	slots[slot] = (int) points;
+	keys.insert(keys.end(), key, key + D);
+	values.insert(values.end(), VD, 0.0f);
+	return (int) points++;
+}
+
+/**
+ * @brief Doubles the hash table, keeping it at most half full
+ *
+ */
+void PermutohedralLattice::Grow() {
+	slots.assign(2 * slots.size(), -1);
+	const std::size_t mask = slots.size() - 1;
+	for (std::size_t point = 0; point < points; point++) {
+		std::size_t slot = Hash(&keys[point * D]) & mask;
+		while (slots[slot] >= 0) slot = (slot + 1) & mask;
+		slots[slot] = (int) point;
+	}
+}
+
+/**
+ * @brief Adds a value to the vertices of the simplex enclosing its position
+ *
+ * @param position D position coordinates, scaled to unit standard deviations
+ * @param value VD values
+ */
+void PermutohedralLattice::Splat(const float *position, const float *value) {
+	int vertexKeys[(D + 1) * D];
+	float barycentric[D + 2];
+	Embed(position, vertexKeys, barycentric);
+
+	for (int remainder = 0; remainder <= D; remainder++) {
+		float *vertex = &values[(std::size_t) Insert(&vertexKeys[remainder * D]) * VD];
+		for (int k = 0; k < VD; k++) vertex[k] += barycentric[remainder] * value[k];
+	}
+}
+
+/**
+ * @brief Blurs the lattice values with a [a, 1 - 2a, a] kernel along each of the D + 1 lattice directions, where
+ * \f$ a = s^2 / 4 \f$ for the resolution \f$ s \f$. Missing neighbours count as zero
+ *
+ */
+void PermutohedralLattice::Blur() {
+	const int latticePoints = (int) points;
+
+	// Neighbour indices along every direction, shared by all the blur passes
+	neighbors.resize((std::size_t) (D + 1) * points * 2);
+	#pragma omp parallel for
+	for (int point = 0; point < latticePoints; point++) {
+		const int *key = &keys[(std::size_t) point * D];
+		int previous[D + 1], next[D + 1];
+		for (int direction = 0; direction <= D; direction++) {
+			for (int k = 0; k < D; k++) {
+				previous[k] = key[k] + 1;
+				next[k] = key[k] - 1;
+			}
+			if (direction < D) {
+				previous[direction] = key[direction] - D;
+				next[direction] = key[direction] + D;
+			}
+			std::size_t index = ((std::size_t) direction * points + (std::size_t) point) * 2;
+			neighbors[index] = Find(previous);
+			neighbors[index + 1] = Find(next);
+		}
+	}
+
+	// The blur variance shrinks with the square of the lattice resolution
+	const float side = 0.25f * resolution * resolution, center = 1.0f - 2.0f * side;
+	blurred.resize(values.size());
+	for (int direction = 0; direction <= D; direction++) {
+		#pragma omp parallel for
+		for (int point = 0; point < latticePoints; point++) {
+			std::size_t index = ((std::size_t) direction * points + (std::size_t) point) * 2;
+			const float *centerValues = &values[(std::size_t) point * VD];
+			float *output = &blurred[(std::size_t) point * VD];
+			for (int k = 0; k < VD; k++) output[k] = center * centerValues[k];
+			for (std::size_t n = 0; n < 2; n++) {
+				int neighbor = neighbors[index + n];
+				if (neighbor < 0) continue;
+				const float *neighborValues = &values[(std::size_t) neighbor * VD];
+				for (int k = 0; k < VD; k++) output[k] += side * neighborValues[k];
+			}
+		}
+		values.swap(blurred);
+	}
+}
+
+/**
+ * @brief Interpolates the blurred lattice values at a position
+ *
+ * @param position D position coordinates, scaled to unit standard deviations
+ * @param value VD output values
+ */
+void PermutohedralLattice::Slice(const float *position, float *value) const {
+	int vertexKeys[(D + 1) * D];
+	float barycentric[D + 2];
+	Embed(position, vertexKeys, barycentric);
+
+	std::fill(value, value + VD, 0.0f);
+	for (int remainder = 0; remainder <= D; remainder++) {
+		int point = Find(&vertexKeys[remainder * D]);
+		if (point < 0) continue;
+		const float *vertex = &values[(std::size_t) point * VD];
+		for (int k = 0; k < VD; k++) value[k] += barycentric[remainder] * vertex[k];
+	}
+}
+
+/**
+ * @brief Gets the number of lattice points
+ *
+ * @return std::size_t lattice points
+ */
+std::size_t PermutohedralLattice::Points() const {
+	return points;
+}
@@ -1,4 +1,5 @@
 #include "ProgramInterface.hpp"
+#include <omp.h>
 
 /**
  * @brief Constructor for the ProgramInterface class. Sets all the necessary parameters for the DeWAFF processing,
@@ -12,9 +13,15 @@ ProgramInterface::ProgramInterface(int argc, char** argv) {
 	benchmarkIterations = 0;
 	quietMode = false; // Print info
 	fileSet = false;
+	pipelineDepth = 0; // Sequential video processing
+	framesInFlight = 1; // One frame at a time with every thread
 
 	// Framework
 	framework = DeWAFF();
+	framework.SetWorkspace(&workspace);
+	CountingAllocator::Install();
+	lastFrameMisses = 0;
+	lastFrameMats = 0;
 	filterType = DBF;
 	windowSize = 3;
 	neighborhoodSize = 3;
@@ -22,7 +29,6 @@ ProgramInterface::ProgramInterface(int argc, char** argv) {
 	rangeSigma = 1.0;
 
 	// Libraries
-	utilsLib = Utils();
 	timer = Timer();
 
 	// Set the program name
@@ -35,6 +41,15 @@ ProgramInterface::ProgramInterface(int argc, char** argv) {
 		SPATIAL_SIGMA,
 		LAMBDA,
 		NEIGHBORHOOD_SIZE,
+		RANGE_LUT,
+		TILE_SIZE,
+		ENGINE,
+		GRID_RESOLUTION,
+		TRIG_TOLERANCE,
+		SYMMETRIC,
+		PRUNE_THRESHOLD,
+		PCA_DIMENSIONS,
+		GUIDED_SUBSAMPLING,
 	};
 
 	// Filter options
@@ -44,6 +59,15 @@ ProgramInterface::ProgramInterface(int argc, char** argv) {
 		"ss",		// spatial_sigma,
 		"lambda",	// lambda,
 		"ns",		// neighborhood_size,
+		"lut",		// range_lut,
+		"tile",		// tile_size,
+		"engine",	// engine,
+		"gr",		// grid_resolution,
+		"tol",		// trig_tolerance,
+		"sym",		// symmetric,
+		"prune",	// prune_threshold,
+		"dims",		// pca_dimensions,
+		"sub",		// guided_subsampling,
 		NULL
 	};
 
@@ -55,6 +79,16 @@ ProgramInterface::ProgramInterface(int argc, char** argv) {
 		{"dgf", DGF}
 	};
 
+	// Map to convert CLI capture option into an engine
+	std::map<std::string, Filters::Engine> engineIdentifierMap = {
+		{"exact", Filters::EXACT},
+		{"grid", Filters::GRID},
+		{"trig", Filters::TRIG},
+		{"integral", Filters::INTEGRAL},
+		{"sliding", Filters::SLIDING},
+		{"pca", Filters::PCA}
+	};
+
 	struct option long_options[] = {
 		  {"image",     	required_argument, 0, 'i'},
 		  {"video",  		required_argument, 0, 'v'},
@@ -62,6 +96,10 @@ ProgramInterface::ProgramInterface(int argc, char** argv) {
 		  {"parameters",    required_argument, 0, 'p'},
 		  {"benchmark",  	required_argument, 0, 'b'},
 		  {"quiet",  		no_argument		, 0, 'q'},
+		  {"isa",  			required_argument, 0, 'I'},
+		  {"pipeline",  	required_argument, 0, 'P'},
+		  {"frames",  		required_argument, 0, 'F'},
+		  {"temporal",  	required_argument, 0, 'T'},
 		  {"help",  		no_argument		, 0, 'H'},
 		  {0, 0, 0, 0}
 	};
@@ -71,7 +109,7 @@ ProgramInterface::ProgramInterface(int argc, char** argv) {
 	int opt, opt_index;
 
 	// Capture user input
-	while ((opt = getopt_long(argc, argv, "b:i:f:v:p:hq", long_options, &opt_index)) != -1) {
+	while ((opt = getopt_long(argc, argv, "b:i:f:v:p:P:F:T:hq", long_options, &opt_index)) != -1) {
 		switch(opt) {
 			case 'i': // Process an image
 				if(mode & video) errorMessage("Options -v and -i are mutually exclusive");
@@ -140,6 +178,73 @@ ProgramInterface::ProgramInterface(int argc, char** argv) {
 							else neighborhoodSize = ns;
 							break;
 						}
+						case RANGE_LUT: {
+							if(value == NULL) abort();
+							int lut = atoi(value);
+							if(lut != 0 && lut != 1) errorMessage("Range LUT option must be 0 or 1");
+							else framework.filtersLib.rangeLUT = lut;
+							break;
+						}
+						case TILE_SIZE: {
+							if(value == NULL) abort();
+							if(std::string(value) == "auto") {
+								framework.filtersLib.tileSize = Filters::AUTO_TILE;
+								break;
+							}
+							int tile = atoi(value);
+							if(tile < 0 || (tile == 0 && std::string(value) != "0")) errorMessage("Tile size must be auto, 0 or a positive number");
+							else framework.filtersLib.tileSize = tile;
+							break;
+						}
+						case ENGINE: {
+							if(value == NULL) abort();
+							auto engine = engineIdentifierMap.find(value);
+							if(engine == engineIdentifierMap.end()) errorMessage("Not a valid engine. Use option --help to check valid engines");
+							else framework.filtersLib.engine = engine->second;
+							break;
+						}
+						case GRID_RESOLUTION: {
+							if(value == NULL) abort();
+							double gr = atof(value);
+							if(gr <= 0 || gr > 1) errorMessage("Grid resolution must be greater than 0 and at most 1");
+							else framework.filtersLib.gridResolution = (float) gr;
+							break;
+						}
+						case TRIG_TOLERANCE: {
+							if(value == NULL) abort();
+							double tol = atof(value);
+							if(tol <= 0 || tol >= 1) errorMessage("Trigonometric tolerance must be between 0 and 1");
+							else framework.filtersLib.trigTolerance = tol;
+							break;
+						}
+						case SYMMETRIC: {
+							if(value == NULL) abort();
+							int sym = atoi(value);
+							if(sym != 0 && sym != 1) errorMessage("Symmetric option must be 0 or 1");
+							else framework.filtersLib.symmetric = sym;
+							break;
+						}
+						case PRUNE_THRESHOLD: {
+							if(value == NULL) abort();
+							double prune = atof(value);
+							if(prune < 0 || prune >= 1) errorMessage("Prune threshold must be at least 0 and smaller than 1");
+							else framework.filtersLib.pruneThreshold = prune;
+							break;
+						}
+						case PCA_DIMENSIONS: {
+							if(value == NULL) abort();
+							int dims = atoi(value);
+							if(dims < 1) errorMessage("PCA dimensions must be 1 or greater");
+							else framework.filtersLib.pcaDimensions = dims;
+							break;
+						}
+						case GUIDED_SUBSAMPLING: {
+							if(value == NULL) abort();
+							int sub = atoi(value);
+							if(sub < 1) errorMessage("Subsampling factor must be 1 or greater");
+							else framework.filtersLib.guidedSubsampling = sub;
+							break;
+						}
 						default:
 							/* Unknown suboption. */
 							std::string s = "Unknown filter option: ";
@@ -152,6 +257,35 @@ ProgramInterface::ProgramInterface(int argc, char** argv) {
 			case 'q':
 				quietMode = true;
 				break;
+			case 'I': { // Instruction set override
+				Kernels::ISA isa = Kernels::SCALAR;
+				if(!Kernels::ParseISA(optarg, isa)) errorMessage("Not a valid instruction set. Use scalar, sse4, avx2 or avx512");
+				if(!Kernels::SetISA(isa)) errorMessage("The processor does not support the " + Kernels::ISAName(isa) + " instruction set");
+				break;
+			}
+			case 'P': { // Pipelined video processing
+				int depth = atoi(optarg);
+				if(depth < 0 || (depth == 0 && std::string(optarg) != "0")) errorMessage("The pipeline queue depth must be 0 or a positive number");
+				else pipelineDepth = depth;
+				break;
+			}
+			case 'F': { // Frame parallel video processing
+				if(std::string(optarg) == "auto") {
+					framesInFlight = AUTO_FRAMES;
+					break;
+				}
+				int frames = atoi(optarg);
+				if(frames < 1) errorMessage("The frames in flight must be auto or 1 or greater");
+				else framesInFlight = frames;
+				break;
+			}
+			case 'T': { // Temporal tile skipping
+				double tolerance = atof(optarg);
+				if(tolerance < 0) errorMessage("The temporal tolerance must be equal or greater than zero");
+				temporalTiles.tolerance = tolerance;
+				framework.temporalTiles = &temporalTiles;
+				break;
+			}
 			case 'H':
 				longHelp();
 				exit(-1);
@@ -168,9 +302,35 @@ ProgramInterface::ProgramInterface(int argc, char** argv) {
 		}
 	}
 
+	// Catch engines that do not apply to the chosen filter
+	if((framework.filtersLib.engine == Filters::GRID || framework.filtersLib.engine == Filters::TRIG) && filterType != DBF && filterType != DSBF)
+		errorMessage("The grid and trig engines only work with the dbf and dsbf filters");
+	if((framework.filtersLib.engine == Filters::INTEGRAL || framework.filtersLib.engine == Filters::SLIDING || framework.filtersLib.engine == Filters::PCA) && filterType != DNLMF)
+		errorMessage("The integral, sliding and pca engines only work with the dnlmf filter");
+	if(framework.filtersLib.guidedSubsampling > 1 && filterType != DGF)
+		errorMessage("The sub option only works with the dgf filter");
+	if(framework.filtersLib.pruneThreshold > 0 && (filterType != DNLMF || framework.filtersLib.engine != Filters::EXACT))
+		errorMessage("The prune option only works with the exact engine of the dnlmf filter");
+	if(framework.filtersLib.symmetric) {
+		bool bilateral = (filterType == DBF || filterType == DSBF) && framework.filtersLib.engine == Filters::EXACT;
+		bool nonLocalMeans = filterType == DNLMF && framework.filtersLib.engine == Filters::INTEGRAL;
+		if(!bilateral && !nonLocalMeans) errorMessage("The symmetric mode only works with the exact engine of the dbf and dsbf filters or the integral engine of the dnlmf filter");
+	}
+
 	// Catch empty file name
 	if(inputFileName.empty() || !fileSet) errorMessage("No file found, use --image <file> to pass an image or --video <file> to pass a video");
 
+	// Catch a pipeline for an image
+	if(pipelineDepth > 0 && !(mode & video)) errorMessage("The pipeline option only works with videos");
+	if(framesInFlight != 1 && !(mode & video)) errorMessage("The frames option only works with videos");
+	if(framesInFlight != 1 && pipelineDepth > 0) errorMessage("Options -P and -F are mutually exclusive");
+	if(framework.temporalTiles && !(mode & video)) errorMessage("The temporal option only works with videos");
+	if(framework.temporalTiles && (framework.filtersLib.engine == Filters::GRID || framework.filtersLib.engine == Filters::TRIG || framework.filtersLib.engine == Filters::PCA))
+		errorMessage("The temporal option does not work with the grid, trig and pca engines, their output depends on the whole frame");
+	if(framework.temporalTiles && framework.filtersLib.guidedSubsampling > 1)
+		errorMessage("The temporal option does not work with the subsampled guided filter, its resampling grid depends on the crop");
+	if(framework.temporalTiles && framesInFlight != 1) errorMessage("Options -T and -F are mutually exclusive, the temporal mode filters the frames in order");
+
 	// Catch extra arguments in the terminal
 	if(argc-1 == optind) {
 		std::string error = "Unexpected argument \"" + (std::string) argv[argc-1] + "\"";
@@ -216,74 +376,281 @@ int ProgramInterface::run() {
 }
 
 /**
- * @brief Pre processes the input. This includes size checking and type checking.
- * It converts the input to a CIELab format for further processing
+ * @brief Pre processes the input. This includes the type checking, 8 bit values always lie in [0, 255] so the
+ * values themselves are not scanned. It converts the input to the planar CIELab format of the filters in a single
+ * pass, the only conversion of the frame before its output
  *
  * @param inputImage
- * @return Mat
+ * @param frameWorkspace workspace holding the converted image
+ * @return LabImage
  */
-Mat ProgramInterface::inputPreProcessor(const Mat &inputImage) {
+LabImage ProgramInterface::inputPreProcessor(const Mat &inputImage, FrameWorkspace &frameWorkspace) {
 	// Input checking
 	int type = inputImage.type();
-	double minVal, maxVal;
-	utilsLib.MinMax(inputImage, &minVal, &maxVal);
-	if(!(type == CV_8UC1 || type == CV_8UC3) || minVal < 0 || maxVal > 255)
-	   errorMessage("Input frame must be a Grayscale or RGB unsigned integer matrix of size NxMx1 or NxMx3 on the closed interval [0,255]");
+	if(!(type == CV_8UC1 || type == CV_8UC3))
+	   errorMessage("Input frame must be a Grayscale or RGB unsigned 8 bit integer matrix of size NxMx1 or NxMx3");
 
-	// Converto to CIELab color space
-	Mat input;
-	inputImage.convertTo(input, CV_32F, 1.0/255.0); // The image has to to have values from 0 to 1 before convertion to CIELab
-	cvtColor(input, input, COLOR_BGR2Lab); // Convert normalized BGR image to CIELab color space.
+	// Convert to CIELab color space, a grayscale frame gives a gray CIELab image
+	LabImage input = FrameWorkspace::AcquireLab(&frameWorkspace, FrameWorkspace::FRAME_INPUT, inputImage.size());
+	LabConverter::BGRToLab(inputImage, input.planes);
 
 	return input;
 }
 
 /**
- * @brief Pos processes the output. It converts the filtered image to its original format
+ * @brief Pos processes the output. It converts the filtered planes to an 8 bit BGR frame in a single pass
  *
  * @param input
+ * @param frameWorkspace workspace holding the converted image
  * @return Mat
  */
-Mat ProgramInterface::outputPosProcessor(const Mat &input) {
-	Mat output;
-	// Convert filtered image back to BGR color space
-	cvtColor(input, output, COLOR_Lab2BGR);
-	//Scale back to [0,255]
-	output.convertTo(output, CV_8U, 255);
+Mat ProgramInterface::outputPosProcessor(const LabImage &input, FrameWorkspace &frameWorkspace) {
+	// Convert filtered image back to BGR color space in [0,255]
+	Mat output = FrameWorkspace::Acquire(&frameWorkspace, FrameWorkspace::OUTPUT_FRAME, input.ImageSize(), CV_8UC3);
+	LabConverter::LabToBGR(input.planes, output);
 
 	return output;
 }
 
 /**
- * @brief Process a frame from an image or a video in the chosen DeWAFF filter
- * @param inputFrame Input frame
- * @return Processed frame
+ * @brief Applies the chosen DeWAFF filter to a CIELab frame. The returned image is a buffer of the
+ * framework workspace, so it is only valid until the next frame is filtered
+ * @param filterFramework framework that filters the frame
+ * @param input CIELab frame
+ * @return Filtered CIELab frame
  */
-Mat ProgramInterface::processFrame(const Mat &inputFrame) {
-	// Process frame
-	Mat input = inputPreProcessor(inputFrame);
-	Mat output;
+LabImage ProgramInterface::filterFrame(DeWAFF &filterFramework, const LabImage &input) {
+	LabImage output;
 	switch (filterType) {
 	case DBF:
-		output = framework.DeceivedBilateralFilter(input, windowSize, spatialSigma, rangeSigma);
+		output = filterFramework.DeceivedBilateralFilter(input, windowSize, spatialSigma, rangeSigma);
 		break;
 	case DSBF:
-		output = framework.DeceivedScaledBilateralFilter(input, windowSize, spatialSigma, rangeSigma);
+		output = filterFramework.DeceivedScaledBilateralFilter(input, windowSize, spatialSigma, rangeSigma);
 		break;
 	case DNLMF:
-		output = framework.DeceivedNonLocalMeansFilter(input, windowSize, neighborhoodSize, spatialSigma, rangeSigma);
+		output = filterFramework.DeceivedNonLocalMeansFilter(input, windowSize, neighborhoodSize, spatialSigma, rangeSigma);
 		break;
 	case DGF:
-		output = framework.DeceivedGuidedFilter(input, windowSize, spatialSigma, rangeSigma);
+		output = filterFramework.DeceivedGuidedFilter(input, windowSize, spatialSigma, rangeSigma);
 		break;
 	default:
 		help();
 		break;
 	}
 
-	return outputPosProcessor(output);
+	return output;
+}
+
+/**
+ * @brief Process a frame from an image or a video in the chosen DeWAFF filter. The intermediate images and the
+ * returned frame are workspace buffers, so the frame is only valid until the next one is processed
+ * @param inputFrame Input frame
+ * @return Processed frame
+ */
+Mat ProgramInterface::processFrame(const Mat &inputFrame) {
+	const unsigned long misses = workspace.Allocations(), mats = CountingAllocator::Allocations();
+
+	// Mark the tiles that changed since the previous frame
+	if(framework.temporalTiles) temporalTiles.Update(inputFrame);
+
+	// Process frame
+	LabImage input = inputPreProcessor(inputFrame, workspace);
+	LabImage output = filterFrame(framework, input);
+	Mat outputFrame = outputPosProcessor(output, workspace);
+	lastFrameMisses = workspace.Allocations() - misses;
+	lastFrameMats = CountingAllocator::Allocations() - mats;
+
+	return outputFrame;
+}
+
+/**
+ * @brief Processes a whole video as a pipeline of five stages: decode, conversion to CIELab, filtering, conversion
+ * back to BGR and encode. Each stage runs in its own thread and hands the frames to the next one through a bounded
+ * lock free queue of pipelineDepth frames, so the decoding, encoding and color conversions overlap the filtering.
+ * There is a single thread per stage and the queues are FIFO, so the frames reach the encoder in the input order.
+ * The frames travel in slots with their own workspace, the encoder returns each slot to the decoder once written
+ *
+ * @param inputVideo opened input video
+ * @param outputVideo opened output video, or null to drop the filtered frames
+ */
+void ProgramInterface::processPipeline(VideoCapture &inputVideo, VideoWriter *outputVideo) {
+	// A slot is either queued between two stages or held by one of them
+	const std::size_t depth = static_cast<std::size_t>(pipelineDepth);
+	std::vector<PipelineFrame> slots(4 * depth + 5);
+	FrameQueue<PipelineFrame*> freeSlots(slots.size());
+	FrameQueue<PipelineFrame*> decoded(depth), converted(depth), filtered(depth), restored(depth);
+	for(PipelineFrame &slot : slots) freeSlots.Push(&slot);
+
+	// A null slot marks the end of the video
+	std::thread decodeStage([&]() {
+		PipelineFrame *slot = freeSlots.Pop();
+		while(inputVideo.read(slot->frame)) {
+			decoded.Push(slot);
+			slot = freeSlots.Pop();
+		}
+		decoded.Push(nullptr);
+	});
+
+	std::thread convertStage([&]() {
+		while(PipelineFrame *slot = decoded.Pop()) {
+			slot->input = inputPreProcessor(slot->frame, slot->workspace);
+			converted.Push(slot);
+		}
+		converted.Push(nullptr);
+	});
+
+	// The filter output lives in the framework workspace, so it is copied to the slot before the next frame
+	std::thread filterStage([&]() {
+		while(PipelineFrame *slot = converted.Pop()) {
+			const unsigned long misses = workspace.Allocations(), mats = CountingAllocator::Allocations();
+			if(framework.temporalTiles) temporalTiles.Update(slot->frame);
+			LabImage output = filterFrame(framework, slot->input);
+			slot->filtered = FrameWorkspace::AcquireLab(&slot->workspace, FrameWorkspace::FILTERED_IMAGE, output.ImageSize());
+			output.CopyTo(slot->filtered);
+			lastFrameMisses = workspace.Allocations() - misses;
+			lastFrameMats = CountingAllocator::Allocations() - mats;
+			filtered.Push(slot);
+		}
+		filtered.Push(nullptr);
+	});
+
+	std::thread restoreStage([&]() {
+		while(PipelineFrame *slot = filtered.Pop()) {
+			slot->output = outputPosProcessor(slot->filtered, slot->workspace);
+			restored.Push(slot);
+		}
+		restored.Push(nullptr);
+	});
+
+	// Encode stage
+	while(PipelineFrame *slot = restored.Pop()) {
+		if(outputVideo) outputVideo->write(slot->output);
+		freeSlots.Push(slot);
+	}
+
+	decodeStage.join();
+	convertStage.join();
+	filterStage.join();
+	restoreStage.join();
+}
+
+
+/**
+ * @brief Processes a whole video filtering several frames at once, each one by its own worker with a smaller
+ * OpenMP team, for resolutions too small to keep every core busy within a frame. A decoder thread fills a ring of
+ * slots, the workers claim the decoded frames in sequence order and the calling thread drains the ring in sequence
+ * order, so the ring works as a reorder buffer in front of the encoder. Each slot is tagged with the sequence
+ * number of its frame once decoded and once filtered, and it is only decoded into again once its frame is written.
+ * The threads block on the tag or the written count they wait for, and its writer notifies them. After the last
+ * frame the decoder hands an empty frame to each worker, which passes it on to the encoder as the end of the video
+ *
+ * @param inputVideo opened input video
+ * @param outputVideo opened output video, or null to drop the filtered frames
+ * @param frames number of frames filtered at once
+ * @param threads OpenMP threads filtering each frame
+ */
+void ProgramInterface::processFrameParallel(VideoCapture &inputVideo, VideoWriter *outputVideo, int frames, int threads) {
+	// The workers keep their framework copy and buffers across benchmark iterations
+	while(frameWorkers.size() < static_cast<std::size_t>(frames)) {
+		frameWorkers.push_back(std::make_unique<FrameWorker>());
+		frameWorkers.back()->framework = framework;
+		frameWorkers.back()->framework.SetWorkspace(&frameWorkers.back()->workspace);
+	}
+
+	// Two slots per worker let the decoder run ahead while the encoder waits for the oldest frame
+	const long capacity = 2 * frames;
+	std::vector<ReorderSlot> slots(static_cast<std::size_t>(capacity));
+	std::atomic<long> claimed(0), written(0);
+	auto slotOf = [&](long sequence) -> ReorderSlot& { return slots[static_cast<std::size_t>(sequence % capacity)]; };
+
+	// Blocks until a slot is tagged with a sequence number
+	auto waitFor = [](const std::atomic<long> &tag, long sequence) {
+		for(long observed; (observed = tag.load(std::memory_order_acquire)) != sequence;) tag.wait(observed, std::memory_order_acquire);
+	};
+
+	// Tags a slot with a sequence number and wakes the threads waiting for it
+	auto publish = [](std::atomic<long> &tag, long sequence) {
+		tag.store(sequence, std::memory_order_release);
+		tag.notify_all();
+	};
+
+	std::thread decodeStage([&]() {
+		// Every worker stops at the first empty frame it claims, so one is decoded per worker
+		bool ended = false;
+		for(long sequence = 0, endFrames = frames; endFrames > 0; sequence++) {
+			for(long done; sequence - (done = written.load(std::memory_order_acquire)) >= capacity;) written.wait(done, std::memory_order_acquire);
+			ReorderSlot &slot = slotOf(sequence);
+			if(ended || !inputVideo.read(slot.frame)) {
+				slot.frame.release();
+				ended = true;
+				endFrames--;
+			}
+			publish(slot.decoded, sequence);
+		}
+	});
+
+	std::vector<std::thread> filterStages;
+	for(int w = 0; w < frames; w++) {
+		filterStages.emplace_back([&, w]() {
+			FrameWorker &worker = *frameWorkers[static_cast<std::size_t>(w)];
+			omp_set_num_threads(threads);
+			for(long sequence = claimed++;; sequence = claimed++) {
+				ReorderSlot &slot = slotOf(sequence);
+				waitFor(slot.decoded, sequence);
+				if(slot.frame.empty()) {
+					slot.output.release();
+					publish(slot.filtered, sequence);
+					break;
+				}
+				const unsigned long misses = worker.workspace.Allocations(), mats = CountingAllocator::Allocations();
+				LabImage input = inputPreProcessor(slot.frame, worker.workspace);
+				Mat output = outputPosProcessor(filterFrame(worker.framework, input), worker.workspace);
+				output.copyTo(slot.output);
+				slot.misses = worker.workspace.Allocations() - misses;
+				slot.mats = CountingAllocator::Allocations() - mats;
+				publish(slot.filtered, sequence);
+			}
+		});
+	}
+
+	// Encode stage, in sequence order
+	for(long sequence = 0;; sequence++) {
+		ReorderSlot &slot = slotOf(sequence);
+		waitFor(slot.filtered, sequence);
+		if(slot.output.empty()) break;
+		if(outputVideo) outputVideo->write(slot.output);
+		lastFrameMisses = slot.misses;
+		lastFrameMats = slot.mats;
+		written.store(sequence + 1, std::memory_order_release);
+		written.notify_all();
+	}
+
+	decodeStage.join();
+	for(std::thread &filterStage : filterStages) filterStage.join();
+	for(std::unique_ptr<FrameWorker> &worker : frameWorkers) framework.filtersLib.MergePruningCounters(worker->framework.filtersLib);
 }
 
+/**
+ * @brief Chooses how many frames are filtered at once and the threads of each one. The row loops of a frame only
+ * scale while each thread gets enough pixels to pay for the team start and the band halos, so in the auto mode a
+ * frame gets one thread per MIN_PIXELS_PER_THREAD pixels and the remaining cores filter other frames. A fixed
+ * number of frames shares the cores evenly
+ *
+ * @param frames number of frames filtered at once
+ * @param threads OpenMP threads filtering each frame
+ */
+void ProgramInterface::frameSplit(int &frames, int &threads) {
+	const int cores = omp_get_num_procs();
+	if(framesInFlight == AUTO_FRAMES) {
+		const long pixels = static_cast<long>(frameSize.width) * frameSize.height;
+		threads = static_cast<int>(std::clamp(pixels / MIN_PIXELS_PER_THREAD, 1L, static_cast<long>(cores)));
+		frames = std::max(cores / threads, 1);
+	} else {
+		frames = framesInFlight;
+		threads = std::max(cores / frames, 1);
+	}
+}
 
 /**
  * @brief Processes an image file
@@ -331,14 +698,20 @@ void ProgramInterface::processVideo() {
 	VideoWriter outputVideo(outputFileName, codec, frameRate , frameSize, true);
 	if(!outputVideo.isOpened()) errorMessage("Could not open the output video for write: " + outputFileName);
 
-	// Read one frame at a time
-	Mat inputFrame, outputFrame;
-	while(inputVideo.read(inputFrame)) {
-		// Process current frame
-		outputFrame = processFrame(inputFrame);
+	int frames, threads;
+	frameSplit(frames, threads);
+	if(frames > 1) processFrameParallel(inputVideo, &outputVideo, frames, threads);
+	else if(pipelineDepth > 0) processPipeline(inputVideo, &outputVideo);
+	else {
+		// Read one frame at a time
+		Mat inputFrame, outputFrame;
+		while(inputVideo.read(inputFrame)) {
+			// Process current frame
+			outputFrame = processFrame(inputFrame);
 
-		// Write frame to output video
-		outputVideo.write(outputFrame);
+			// Write frame to output video
+			outputVideo.write(outputFrame);
+		}
 	}
 
 	// Release video resources
@@ -382,6 +755,8 @@ void ProgramInterface::benchmarkImage() {
 			if(i != benchmarkIterations) std::cout << std::endl;
 		}
 		displayBenchmarkFooter();
+
+		if(framework.filtersLib.engine != Filters::EXACT || framework.filtersLib.guidedSubsampling > 1) displayApproximationError(inputFrame);
 }
 
 /**
@@ -403,16 +778,25 @@ void ProgramInterface::benchmarkVideo() {
 
 	Mat inputFrame, outputFrame;
 	double elapsedSeconds;
+	int frames, threads;
+	frameSplit(frames, threads);
 
 	displayBenchmarkHeader();
 	for(int i = 1; i <= benchmarkIterations; i++) {
+		// Every iteration starts from a whole first frame
+		temporalTiles.Reset();
+
 		// Start timer
 		timer.start();
 
 		// Read one frame at a time
-		while(inputVideo.read(inputFrame)) {
-			// Process current frame
-			processFrame(inputFrame);
+		if(frames > 1) processFrameParallel(inputVideo, nullptr, frames, threads);
+		else if(pipelineDepth > 0) processPipeline(inputVideo, nullptr);
+		else {
+			while(inputVideo.read(inputFrame)) {
+				// Process current frame
+				processFrame(inputFrame);
+			}
 		}
 
 		// Update timer
@@ -430,6 +814,9 @@ void ProgramInterface::benchmarkVideo() {
 		inputVideo = VideoCapture(inputFileName);
 	}
 	displayBenchmarkFooter();
+
+	// Measure the approximation error on the first frame
+	if((framework.filtersLib.engine != Filters::EXACT || framework.filtersLib.guidedSubsampling > 1) && inputVideo.read(inputFrame)) displayApproximationError(inputFrame);
 }
 
 /**
@@ -505,6 +892,13 @@ void ProgramInterface::displayImageInfo() {
  *
  */
 void ProgramInterface::displayBenchmarkHeader() {
+	// Count the kernel cache use, the workspace use and the pruned patches of the benchmark only
+	Utils::kernelCache.ResetCounters();
+	workspace.ResetCounters();
+	temporalTiles.ResetCounters();
+	for(std::unique_ptr<FrameWorker> &worker : frameWorkers) worker->workspace.ResetCounters();
+	framework.filtersLib.ResetPruningCounters();
+
 	// Print header
 	std::cout << std::internal <<"\nBenchmark mode" << std::endl;
 	std::cout << std::setw(BENCHMARK_LINE) << std::setfill('-') << '\n' << std::setfill(' ');
@@ -517,11 +911,112 @@ void ProgramInterface::displayBenchmarkHeader() {
 }
 
 /**
- * @brief Prints the benchmark footer
+ * @brief Prints the benchmark footer along with the kernel cache and frame workspace use during the benchmark.
+ * Once the buffers of the first frame are in the workspace the following frames do not miss it. The Mat buffers
+ * of the last frame are counted by the default allocator, so they also include the scratch images that are not
+ * kept in the workspace; with several frames in flight the other frames allocate in the same interval
  *
  */
 void ProgramInterface::displayBenchmarkFooter() {
+	// The frame parallel workers have their own workspaces
+	unsigned long allocations = workspace.Allocations(), reuses = workspace.Reuses();
+	for(std::unique_ptr<FrameWorker> &worker : frameWorkers) {
+		allocations += worker->workspace.Allocations();
+		reuses += worker->workspace.Reuses();
+	}
+
 	std::cout << std::setw(BENCHMARK_LINE) << std::setfill('-') << '\n' << std::setfill(' ') << std::endl;
+
+	std::cout << "\nKernel cache" << std::endl;
+	std::cout << std::setw(MAIN_LINE) << std::setfill('-') << '\n' << std::setfill(' ');
+	std::cout << "| "
+	<< std::left << std::setw(DATA_SPACE) << "Data"
+	<< " | "
+	<< std::left << std::setw(VALUE_SPACE+1) << "Value"
+	<< "|";
+	std::cout << std::setw(MAIN_LINE) << std::setfill('-') << '\n' << std::setfill(' ') << std::endl;
+	std::cout << "| " << std::setw(DATA_SPACE) << std::left  << "Hits"  << " | "  << std::setw(VALUE_SPACE) << std::left << Utils::kernelCache.Hits()	<< " |" << std::endl;
+	std::cout << "| " << std::setw(DATA_SPACE) << std::left  << "Misses" << " | " 	<< std::setw(VALUE_SPACE) << std::left << Utils::kernelCache.Misses()		<< " |";
+	std::cout << std::setw(MAIN_LINE) << std::setfill('-') << '\n' << std::setfill(' ') << std::endl;
+
+	std::cout << "\nFrame workspace" << std::endl;
+	std::cout << std::setw(MAIN_LINE) << std::setfill('-') << '\n' << std::setfill(' ');
+	std::cout << "| "
+	<< std::left << std::setw(DATA_SPACE) << "Data"
+	<< " | "
+	<< std::left << std::setw(VALUE_SPACE+1) << "Value"
+	<< "|";
+	std::cout << std::setw(MAIN_LINE) << std::setfill('-') << '\n' << std::setfill(' ') << std::endl;
+	std::cout << "| " << std::setw(DATA_SPACE) << std::left  << "Allocated"  << " | "  << std::setw(VALUE_SPACE) << std::left << allocations	<< " |" << std::endl;
+	std::cout << "| " << std::setw(DATA_SPACE) << std::left  << "Reused"  << " | "  << std::setw(VALUE_SPACE) << std::left << reuses	<< " |" << std::endl;
+	std::cout << "| " << std::setw(DATA_SPACE) << std::left  << "Last frame" << " | " 	<< std::setw(VALUE_SPACE) << std::left << lastFrameMisses		<< " |" << std::endl;
+	std::cout << "| " << std::setw(DATA_SPACE) << std::left  << "Mat allocations" << " | " 	<< std::setw(VALUE_SPACE) << std::left << lastFrameMats		<< " |";
+	std::cout << std::setw(MAIN_LINE) << std::setfill('-') << '\n' << std::setfill(' ') << std::endl;
+
+	if(framework.temporalTiles) {
+		std::cout << "\nTemporal tiles" << std::endl;
+		std::cout << std::setw(MAIN_LINE) << std::setfill('-') << '\n' << std::setfill(' ');
+		std::cout << "| "
+		<< std::left << std::setw(DATA_SPACE) << "Data"
+		<< " | "
+		<< std::left << std::setw(VALUE_SPACE+1) << "Value"
+		<< "|";
+		std::cout << std::setw(MAIN_LINE) << std::setfill('-') << '\n' << std::setfill(' ') << std::endl;
+		std::ostringstream stringStream;
+		stringStream << std::fixed << std::setprecision(2) << 100.0 * temporalTiles.SkippedFraction() << " %";
+		std::cout << "| " << std::setw(DATA_SPACE) << std::left  << "Skipped" << " | " 	<< std::setw(VALUE_SPACE) << std::left << stringStream.str()		<< " |";
+		std::cout << std::setw(MAIN_LINE) << std::setfill('-') << '\n' << std::setfill(' ') << std::endl;
+	}
+
+	if(framework.filtersLib.pruneThreshold > 0) {
+		std::cout << "\nPatch pre-selection" << std::endl;
+		std::cout << std::setw(MAIN_LINE) << std::setfill('-') << '\n' << std::setfill(' ');
+		std::cout << "| "
+		<< std::left << std::setw(DATA_SPACE) << "Data"
+		<< " | "
+		<< std::left << std::setw(VALUE_SPACE+1) << "Value"
+		<< "|";
+		std::cout << std::setw(MAIN_LINE) << std::setfill('-') << '\n' << std::setfill(' ') << std::endl;
+		std::ostringstream stringStream;
+		stringStream << std::fixed << std::setprecision(2) << 100.0 * framework.filtersLib.PrunedFraction() << " %";
+		std::cout << "| " << std::setw(DATA_SPACE) << std::left  << "Pruned" << " | " 	<< std::setw(VALUE_SPACE) << std::left << stringStream.str()		<< " |";
+		std::cout << std::setw(MAIN_LINE) << std::setfill('-') << '\n' << std::setfill(' ') << std::endl;
+	}
+}
+
+/**
+ * @brief Prints the error of an approximate engine or of the subsampled guided filter against the exact filter for a frame.
+ * Both outputs are compared in their final 8 bit BGR format
+ *
+ * @param inputFrame frame to process with both engines
+ */
+void ProgramInterface::displayApproximationError(const Mat &inputFrame) {
+	// The exact frame reuses the buffers of the approximate one, both are filtered whole
+	TemporalTiles *tiles = framework.temporalTiles;
+	framework.temporalTiles = nullptr;
+	Mat approximateFrame = processFrame(inputFrame).clone();
+	Filters::Engine engine = framework.filtersLib.engine;
+	int subsampling = framework.filtersLib.guidedSubsampling;
+	framework.filtersLib.engine = Filters::EXACT;
+	framework.filtersLib.guidedSubsampling = 1;
+	Mat exactFrame = processFrame(inputFrame);
+	framework.filtersLib.engine = engine;
+	framework.filtersLib.guidedSubsampling = subsampling;
+	framework.temporalTiles = tiles;
+
+	std::cout << "\nApproximation error" << std::endl;
+	std::cout << std::setw(MAIN_LINE) << std::setfill('-') << '\n' << std::setfill(' ');
+	std::cout << "| "
+	<< std::left << std::setw(DATA_SPACE) << "Data"
+	<< " | "
+	<< std::left << std::setw(VALUE_SPACE+1) << "Value"
+	<< "|";
+	std::cout << std::setw(MAIN_LINE) << std::setfill('-') << '\n' << std::setfill(' ') << std::endl;
+	std::ostringstream stringStream;
+	stringStream << std::fixed << std::setprecision(2) << PSNR(exactFrame, approximateFrame) << " dB";
+	std::cout << "| " << std::setw(DATA_SPACE) << std::left  << "PSNR"  << " | "  << std::setw(VALUE_SPACE) << std::left << stringStream.str()	<< " |" << std::endl;
+	std::cout << "| " << std::setw(DATA_SPACE) << std::left  << "Max error" << " | " 	<< std::setw(VALUE_SPACE) << std::left << norm(exactFrame, approximateFrame, NORM_INF)		<< " |";
+	std::cout << std::setw(MAIN_LINE) << std::setfill('-') << '\n' << std::setfill(' ') << std::endl;
 }
 
 /**
@@ -533,7 +1028,10 @@ void ProgramInterface::help() {
 	<< "[-i | --image <file name>] | [-v | --video <file name>]" << std::endl
 	<< "\t\t" << "[-f | --filter <filter type>]" << std::endl
 	<< "\t\t" << "[-p | --parameters <filter parameters>]" << std::endl
-	<< "\t\t" << "[-b | --benchmark <number of iterations>] [-h | --help]"
+	<< "\t\t" << "[-b | --benchmark <number of iterations>] [--isa <instruction set>]" << std::endl
+	<< "\t\t" << "[-P | --pipeline <queue depth>] | [-F | --frames <frames in flight>]" << std::endl
+	<< "\t\t" << "[-T | --temporal <tolerance>]" << std::endl
+	<< "\t\t" << "[-h | --help]"
 	<< std::endl;
 }
 
@@ -583,12 +1081,47 @@ void ProgramInterface::longHelp() {
 	<< "\n\t\t" << std::setw(9) << "- ss:" << "Spatial Sigma"
 	<< "\n\t\t" << std::setw(9) << "- lambda:" << "Lambda value for the Laplacian deceive"
 	<< "\n\t\t" << std::setw(9) << "- ns:" << "Neighborhood size for the DNLM filter"
+	<< "\n\t\t" << std::setw(9) << "- lut:" << "Range kernel from a lookup table (1) or exact (0)"
+	<< "\n\t\t" << std::setw(9) << "- tile:" << "Tile size for the bilateral filters, auto or 0 for rows"
+	<< "\n\t\t" << std::setw(9) << "- engine:" << "Filter engine: exact, grid, trig, integral, sliding or pca"
+	<< "\n\t\t" << std::setw(9) << "- gr:" << "Grid resolution in (0, 1] for the grid engine"
+	<< "\n\t\t" << std::setw(9) << "- tol:" << "Range kernel tolerance for the trig engine"
+	<< "\n\t\t" << std::setw(9) << "- sym:" << "Evaluate each pair of pixels once (1) or twice (0)"
+	<< "\n\t\t" << std::setw(9) << "- prune:" << "DNLM patch pre-selection threshold in [0, 1), 0 disables it"
+	<< "\n\t\t" << std::setw(9) << "- dims:" << "Patch descriptor dimensions for the pca engine"
+	<< "\n\t\t" << std::setw(9) << "- sub:" << "DGF coefficient subsampling factor, 1 disables it"
 	<< "\n\t" << "It is possible to change one or more parameters in the same line,"
 	<< "\n\t" << "for example \'-p ws=15,rs=10,ss=10\' would change the window size and"
 	<< "\n\t" << "the range and spatial sigma values for the filter. Using just"
 	<< "\n\t" << "\'-p ws=15\' would only change its window size."
 	<< "\n\t" << "The \'ns\' option only works with the filter set to \'dnlm\'."
 	<< "\n\t" << "If \'lambda=0\' the Laplacian the deceive will be disabled."
+	<< "\n\t" << "The \'lut\' option only works with the bilateral and NLM filters."
+	<< "\n\t" << "The \'tile\' option only works with the bilateral filters, by default"
+	<< "\n\t" << "the tiles are sized to fit the L2 cache."
+	<< "\n\t" << "The \'grid\' engine approximates the bilateral filters through a"
+	<< "\n\t" << "permutohedral lattice whose cost does not depend on the window size."
+	<< "\n\t" << "Lower grid resolutions are faster but less accurate. The \'trig\'"
+	<< "\n\t" << "engine expands the range kernel in raised cosines, each term is a"
+	<< "\n\t" << "Gaussian blur. Its term count grows as the range sigma or the"
+	<< "\n\t" << "tolerance decrease, so it suits large range sigmas. The \'integral\'"
+	<< "\n\t" << "engine evaluates the DNLM patch distances through integral images,"
+	<< "\n\t" << "so its cost does not depend on the neighborhood size. The \'sliding\'"
+	<< "\n\t" << "engine gives the exact DNLM output, it reuses the patch distances"
+	<< "\n\t" << "of the previous column. In benchmark mode the error against the"
+	<< "\n\t" << "exact engine is reported."
+	<< "\n\t" << "The \'sym\' option evaluates the symmetric weights once per pair of"
+	<< "\n\t" << "pixels. It works with the exact engine of the bilateral filters and"
+	<< "\n\t" << "the integral engine of the DNLM filter."
+	<< "\n\t" << "The \'prune\' option discards the DNLM candidate patches whose mean"
+	<< "\n\t" << "and deviation guarantee a weight below the threshold times the"
+	<< "\n\t" << "largest weight. In benchmark mode the pruned fraction is reported."
+	<< "\n\t" << "The \'pca\' engine compares DNLM patch descriptors of \'dims\' values"
+	<< "\n\t" << "projected on a PCA basis learned from the image, instead of the"
+	<< "\n\t" << "full patches."
+	<< "\n\t" << "With \'sub\' greater than 1 the DGF linear coefficients are computed"
+	<< "\n\t" << "at 1/sub resolution and upsampled (Fast Guided Filter). In benchmark"
+	<< "\n\t" << "mode its error against the full resolution filter is reported."
 	<< "\n" << std::endl
 
 	<< "\t" << std::left << "-b, --benchmark"
@@ -601,6 +1134,43 @@ void ProgramInterface::longHelp() {
 	<< "\n\t" << "ten separate times."
 	<< "\n" << std::endl
 
+	<< "\t" << std::left << "--isa"
+	<< ": " << "Override the instruction set used by the filter kernels. By default"
+	<< "\n\t" << "the widest one supported by the processor is detected at startup."
+	<< "\n\t\t" << std::setw(9) << "- scalar:" << "no vector instructions"
+	<< "\n\t\t" << std::setw(9) << "- sse4:" << "SSE4.1, four pixels per instruction"
+	<< "\n\t\t" << std::setw(9) << "- avx2:" << "AVX2 and FMA, eight pixels per instruction"
+	<< "\n\t\t" << std::setw(9) << "- avx512:" << "AVX-512F, sixteen pixels per instruction"
+	<< "\n\t" << "Example: \'--isa avx2\'"
+	<< "\n" << std::endl
+
+	<< "\t" << std::left << "-P, --pipeline"
+	<< ": " << "Process a video as a pipeline of threads for the decoding,"
+	<< "\n\t" << "the color conversions, the filtering and the encoding. The stages"
+	<< "\n\t" << "are connected by queues of the given depth and the frames are"
+	<< "\n\t" << "written in order. 0 processes one frame at a time (default)."
+	<< "\n\t" << "Example: \'-v video.mp4 -P 4\'"
+	<< "\n" << std::endl
+
+	<< "\t" << std::left << "-F, --frames"
+	<< ": " << "Filter several frames of a video at once, each one with a"
+	<< "\n\t" << "share of the cores, and write them in order. With \'auto\' the"
+	<< "\n\t" << "number of frames is chosen from the frame size and the core count,"
+	<< "\n\t" << "small frames get more frames in flight and fewer threads each."
+	<< "\n\t" << "1 filters one frame at a time with every core (default)."
+	<< "\n\t" << "Example: \'-v video.mp4 -F auto\'"
+	<< "\n" << std::endl
+
+	<< "\t" << std::left << "-T, --temporal"
+	<< ": " << "Only refilter the video tiles that changed since the previous"
+	<< "\n\t" << "frame, along with the tiles within the reach of the filter, and"
+	<< "\n\t" << "reuse the previous output elsewhere. A tile changed if any of its"
+	<< "\n\t" << "8 bit values moved by more than the tolerance. In benchmark mode"
+	<< "\n\t" << "the fraction of skipped tiles is reported. It does not work with"
+	<< "\n\t" << "the grid, trig and pca engines, nor with \'sub\' above 1."
+	<< "\n\t" << "Example: \'-v video.mp4 -T 2\'"
+	<< "\n" << std::endl
+
 	<< "\t" << std::left << "-q, --quiet"
 	<< ": " << "Run in quiet mode. Does not displays the file and"
 	<< "\n\t" << "filter information."
@@ -681,7 +1251,40 @@ void ProgramInterface::displayFilterParams() {
 	if(filterType == DNLMF) std::cout << "| " << std::setw(PARAM_DESC_SPACE) << std::left  << "Neighborhood size"  << " | "  << std::setw(PARAM_VAL_SPACE) << std::left << neighborhoodSize	<< " |" << std::endl;
 	std::cout << "| " << std::setw(PARAM_DESC_SPACE) << std::left  << "Range Sigma"  << " | "  << std::setw(PARAM_VAL_SPACE) << std::left << rangeSigma	<< " |" << std::endl;
 	std::cout << "| " << std::setw(PARAM_DESC_SPACE) << std::left  << "Spatial Sigma"  << " | "  << std::setw(PARAM_VAL_SPACE) << std::left << spatialSigma	<< " |" << std::endl;
-	std::cout << "| " << std::setw(PARAM_DESC_SPACE) << std::left  << "USM Lambda"  << " | "  << std::setw(PARAM_VAL_SPACE) << std::left << framework.usmLambda	<< " |";
+	std::cout << "| " << std::setw(PARAM_DESC_SPACE) << std::left  << "USM Lambda"  << " | "  << std::setw(PARAM_VAL_SPACE) << std::left << framework.usmLambda	<< " |" << std::endl;
+	std::map<int, std::string> engineNameMap = {
+		{Filters::EXACT, "Exact"},
+		{Filters::GRID, "Permutohedral lattice"},
+		{Filters::TRIG, "Raised cosine expansion"},
+		{Filters::INTEGRAL, "Integral images"},
+		{Filters::SLIDING, "Sliding column sums"},
+		{Filters::PCA, "PCA patch descriptors"}
+	};
+	std::cout << "| " << std::setw(PARAM_DESC_SPACE) << std::left  << "Engine"  << " | "  << std::setw(PARAM_VAL_SPACE) << std::left << engineNameMap[framework.filtersLib.engine]	<< " |" << std::endl;
+	if(framework.filtersLib.engine == Filters::GRID) std::cout << "| " << std::setw(PARAM_DESC_SPACE) << std::left  << "Grid resolution"  << " | "  << std::setw(PARAM_VAL_SPACE) << std::left << framework.filtersLib.gridResolution	<< " |" << std::endl;
+	if(framework.filtersLib.engine == Filters::PCA) std::cout << "| " << std::setw(PARAM_DESC_SPACE) << std::left  << "PCA dimensions"  << " | "  << std::setw(PARAM_VAL_SPACE) << std::left << std::min(framework.filtersLib.pcaDimensions, 3 * neighborhoodSize * neighborhoodSize)	<< " |" << std::endl;
+	if(framework.filtersLib.engine == Filters::TRIG) std::cout << "| " << std::setw(PARAM_DESC_SPACE) << std::left  << "Trig tolerance"  << " | "  << std::setw(PARAM_VAL_SPACE) << std::left << framework.filtersLib.trigTolerance	<< " |" << std::endl;
+	if(filterType != DGF && framework.filtersLib.engine != Filters::GRID && framework.filtersLib.engine != Filters::TRIG) std::cout << "| " << std::setw(PARAM_DESC_SPACE) << std::left  << "Range kernel"  << " | "  << std::setw(PARAM_VAL_SPACE) << std::left << (framework.filtersLib.rangeLUT ? "Lookup table" : "Exponential")	<< " |" << std::endl;
+	if(framework.filtersLib.guidedSubsampling > 1) std::cout << "| " << std::setw(PARAM_DESC_SPACE) << std::left  << "Subsampling"  << " | "  << std::setw(PARAM_VAL_SPACE) << std::left << framework.filtersLib.guidedSubsampling	<< " |" << std::endl;
+	if(framework.filtersLib.pruneThreshold > 0) std::cout << "| " << std::setw(PARAM_DESC_SPACE) << std::left  << "Prune threshold"  << " | "  << std::setw(PARAM_VAL_SPACE) << std::left << framework.filtersLib.pruneThreshold	<< " |" << std::endl;
+	if(framework.filtersLib.symmetric) std::cout << "| " << std::setw(PARAM_DESC_SPACE) << std::left  << "Pair weights"  << " | "  << std::setw(PARAM_VAL_SPACE) << std::left << "Symmetric"	<< " |" << std::endl;
+	if((filterType == DBF || filterType == DSBF) && framework.filtersLib.engine == Filters::EXACT && !framework.filtersLib.symmetric) {
+		int tile = framework.filtersLib.TileSize(windowSize);
+		std::ostringstream stringStream;
+		if(tile > 0) stringStream << tile << "x" << tile << (framework.filtersLib.tileSize == Filters::AUTO_TILE ? " (auto)" : "");
+		else stringStream << "Rows";
+		std::cout << "| " << std::setw(PARAM_DESC_SPACE) << std::left  << "Tile size"  << " | "  << std::setw(PARAM_VAL_SPACE) << std::left << stringStream.str()	<< " |" << std::endl;
+	}
+	if(framesInFlight != 1) {
+		int frames, threads;
+		frameSplit(frames, threads);
+		std::ostringstream stringStream;
+		stringStream << frames << " x " << threads << " threads" << (framesInFlight == AUTO_FRAMES ? " (auto)" : "");
+		std::cout << "| " << std::setw(PARAM_DESC_SPACE) << std::left  << "Frames in flight"  << " | "  << std::setw(PARAM_VAL_SPACE) << std::left << stringStream.str()	<< " |" << std::endl;
+	}
+	if(framework.temporalTiles) std::cout << "| " << std::setw(PARAM_DESC_SPACE) << std::left  << "Tile tolerance"  << " | "  << std::setw(PARAM_VAL_SPACE) << std::left << temporalTiles.tolerance	<< " |" << std::endl;
+	if(pipelineDepth > 0) std::cout << "| " << std::setw(PARAM_DESC_SPACE) << std::left  << "Pipeline depth"  << " | "  << std::setw(PARAM_VAL_SPACE) << std::left << pipelineDepth	<< " |" << std::endl;
+	std::cout << "| " << std::setw(PARAM_DESC_SPACE) << std::left  << "Instruction set"  << " | "  << std::setw(PARAM_VAL_SPACE) << std::left << Kernels::ISAName(Kernels::ActiveISA())	<< " |";
 
 	std::cout << std::setw(PARAMS_LINE) << std::setfill('-') << '\n' << std::setfill(' ') << std::endl;
 }
\ No newline at end of file
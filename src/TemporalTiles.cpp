@@ -0,0 +1,114 @@
+#include "TemporalTiles.hpp"
+
+/**
+ * @brief TemporalTiles class constructor. Starts without a reference, so the first frame changes every tile
+ *
+ */
+TemporalTiles::TemporalTiles(): tolerance(0.0), skippedTiles(0), totalTiles(0) {}
+
+/**
+ * @brief Compares a frame against the reference and marks its changed tiles. A frame of a new size or type
+ * becomes the reference with every tile changed
+ *
+ * @param frame incoming video frame
+ */
+void TemporalTiles::Update(const Mat &frame) {
+	const int tileRows = (frame.rows + TILE_SIZE - 1) / TILE_SIZE;
+	const int tileCols = (frame.cols + TILE_SIZE - 1) / TILE_SIZE;
+
+	if (reference.size() != frame.size() || reference.type() != frame.type()) {
+		frame.copyTo(reference);
+		changed = Mat::ones(tileRows, tileCols, CV_8U);
+		return;
+	}
+
+	changed.create(tileRows, tileCols, CV_8U);
+	const Rect frameRect(0, 0, frame.cols, frame.rows);
+	#pragma omp parallel for shared(frame)
+	for (int ti = 0; ti < tileRows; ti++) {
+		uchar *changedRow = changed.ptr<uchar>(ti);
+		for (int tj = 0; tj < tileCols; tj++) {
+			const Rect tile = Rect(tj * TILE_SIZE, ti * TILE_SIZE, TILE_SIZE, TILE_SIZE) & frameRect;
+			changedRow[tj] = norm(frame(tile), reference(tile), NORM_INF) > tolerance;
+			if (changedRow[tj]) frame(tile).copyTo(reference(tile));
+		}
+	}
+}
+
+/**
+ * @brief Gets the output regions that have to be refiltered. An output pixel depends on the input within the
+ * radius of the filter, so the changed tiles are dilated by the radius rounded up to whole tiles. The dirty tiles
+ * are gathered in runs along each tile row, and a run spanning the same columns as one of the row above extends it,
+ * so a moving object gives a few rectangles instead of one per tile
+ *
+ * @param radius reach of the filter in pixels, from an input pixel to the outputs it changes
+ * @param all refilter the whole frame, for example when a global parameter of the filter changed
+ * @return std::vector<Rect> regions to refilter, in pixels
+ */
+std::vector<Rect> TemporalTiles::DirtyRegions(int radius, bool all) {
+	const Rect frameRect(0, 0, reference.cols, reference.rows);
+	totalTiles += changed.total();
+	if (all) return {frameRect};
+
+	const int reach = (radius + TILE_SIZE - 1) / TILE_SIZE;
+	Mat dirty;
+	dilate(changed, dirty, Mat::ones(2 * reach + 1, 2 * reach + 1, CV_8U));
+	skippedTiles += dirty.total() - (unsigned long) countNonZero(dirty);
+
+	std::vector<Rect> regions;
+	std::vector<std::size_t> above, current; // Regions that end on the previous and the current tile row
+	for (int ti = 0; ti < dirty.rows; ti++) {
+		const uchar *dirtyRow = dirty.ptr<uchar>(ti);
+		for (int tj = 0; tj < dirty.cols; tj++) {
+			if (!dirtyRow[tj]) continue;
+			int end = tj;
+			while (end < dirty.cols && dirtyRow[end]) end++;
+			const Rect run = Rect(Point(tj * TILE_SIZE, ti * TILE_SIZE), Point(end * TILE_SIZE, (ti + 1) * TILE_SIZE)) & frameRect;
+			tj = end;
+
+			bool merged = false;
+			for (std::size_t k : above) {
+				if (regions[k].x == run.x && regions[k].width == run.width) {
+					regions[k].height += run.height;
+					current.push_back(k);
+					merged = true;
+					break;
+				}
+			}
+			if (!merged) {
+				current.push_back(regions.size());
+				regions.push_back(run);
+			}
+		}
+		above.swap(current);
+		current.clear();
+	}
+
+	return regions;
+}
+
+/**
+ * @brief Drops the reference, so the next frame changes every tile
+ *
+ */
+void TemporalTiles::Reset() {
+	reference.release();
+}
+
+/**
+ * @brief Gets the fraction of the tiles whose output was reused since the counters were reset
+ *
+ * @return double skipped fraction in [0, 1]
+ */
+double TemporalTiles::SkippedFraction() const {
+	return totalTiles ? (double) skippedTiles / (double) totalTiles : 0.0;
+}
+
+/**
+ * @brief Resets the tile counters
+ *
+ */
+void TemporalTiles::ResetCounters() {
+	skippedTiles = 0;
+	totalTiles = 0;
+}
@@ -1,5 +1,13 @@
 #include "Utils.hpp"
 
+KernelCache Utils::kernelCache;
+
+/**
+ * @brief Utils class constructor. The images are allocated on every call until a workspace is set
+ *
+ */
+Utils::Utils(): workspace(nullptr), usmScale(0.0f) {}
+
 /**
  * @brief Generates a meshgrid from \f$X\f$ and \f$Y\f$ unidimensional coordinates.
  * Example:
@@ -32,26 +40,6 @@ void Utils::MeshGrid(const Range &range, Mat &X, Mat &Y) {
 	Y.convertTo(Y, CV_32F);
 }
 
-/**
- * @brief Gets the global min and max values of a 3 channel Matrix.
- *
- * @param A Input matrix
- * @param minA Minimun value of the matrix A
- * @param maxA Maximun value of the matrix A
- */
-void Utils::MinMax(const Mat& A, double* minA, double* maxA) {
-	double minT, maxT;
-	std::vector<Mat> channels(3);
-	split(A,channels);
-	minMaxLoc(channels[0],minA,maxA);
-	minMaxLoc(channels[1],&minT,&maxT);
-	*minA = std::min(*minA,minT);
-	*maxA = std::max(*maxA,maxT);
-	minMaxLoc(channels[2],&minT,&maxT);
-	*minA = std::min(*minA,minT);
-	*maxA = std::max(*maxA,maxT);
-}
-
 /**
  * @brief Computes the Gaussian function of an input \f$ X \f$
  * \f[ G(X) = \frac{1}{\sigma\sqrt{2\pi}} \exp\left( -\frac{X}{2\sigma^2} \right) \f]
@@ -67,29 +55,97 @@ Mat Utils::GaussianFunction(Mat input, double sigma){
 	return output;
 }
 
+/**
+ * @brief Gets the unnormalized spatial Gaussian kernel of the bilateral filters
+ * \f[ G_{\text spatial}(X, Y) = \frac{1}{\sqrt{2\pi} \sigma} \exp\left( -\frac{ X^2 + Y^2 }{ 2 \sigma^2} \right) \f]
+ * where \f$X\f$ and \f$Y\f$ are the horizontal and vertical coordinates on a windowSize\f$ \times \f$windowSize 2D plane.
+ * The kernel is kept in the kernel cache and must not be modified
+ * @param windowSize size of the window for the kernel
+ * @param sigma spatial standard deviation
+ * @return const Mat& continuous CV_32F spatial Gaussian kernel
+ */
+const Mat &Utils::SpatialGaussianKernel(int windowSize, double sigma) {
+	return kernelCache.Get(KernelCache::SPATIAL_GAUSSIAN, windowSize, sigma, [&]() {
+		// Pre compute the m - p = |m-p| factors
+		Mat X, Y;
+		Range range = Range(-(windowSize/2), (windowSize/2) + 1);
+		MeshGrid(range, X, Y);
+		pow(X, 2.0, X);
+		pow(Y, 2.0, Y);
+		return GaussianFunction(X + Y, sigma);
+	});
+}
+
 /**
  * @brief Computes a normalized Gaussian kernel
  * \f[ G(X, Y) =  \frac{1}{2\pi \sigma^2} \exp\left( -\frac{ X^2 + Y^2 }{ 2 \sigma_s^2} \right) \f]
  * where \f$X\f$ and \f$Y\f$ are the horizontal and vertical coordinates on a windowSize\f$ \times \f$windowSize 2D plane.
+ * The kernel is kept in the kernel cache and must not be modified
  * @param windowSize size of the window for the kernel
  * @param sigma standard deviation for the Gaussian distribution
- * @return Mat Gaussian kernel
+ * @return const Mat& Gaussian kernel
  */
-Mat Utils::GaussianKernel(int windowSize, double sigma) {
-	// Pre computation of meshgrid values
-	Mat1f X, Y;
-	Range range = Range(-(windowSize/2), (windowSize/2) + 1);
-	MeshGrid(range, X, Y);
-	pow(X, 2.0, X);
-	pow(Y, 2.0, Y);
-
-	// Compute the Gaussian kernel
-	Mat gaussianKernel = GaussianFunction(X, sigma).mul(GaussianFunction(Y, sigma));
+const Mat &Utils::GaussianKernel(int windowSize, double sigma) {
+	return kernelCache.Get(KernelCache::GAUSSIAN, windowSize, sigma, [&]() {
+		// Pre computation of meshgrid values
+		Mat1f X, Y;
+		Range range = Range(-(windowSize/2), (windowSize/2) + 1);
+		MeshGrid(range, X, Y);
+		pow(X, 2.0, X);
+		pow(Y, 2.0, Y);
+
+		// Compute the Gaussian kernel
+		Mat gaussianKernel = GaussianFunction(X, sigma).mul(GaussianFunction(Y, sigma));
+
+		// Normalization
+		gaussianKernel /= sum(gaussianKernel).val[0];
+
+		return gaussianKernel;
+	});
+}
 
-	// Normalization
-	gaussianKernel /= sum(gaussianKernel).val[0];
+/**
+ * @brief Gets the normalized 1D Gaussian kernel of the separable Gaussian blurs, applied along the rows and then
+ * along the columns. The kernel is kept in the kernel cache and must not be modified
+ * @param windowSize size of the window for the kernel
+ * @param sigma standard deviation for the Gaussian distribution
+ * @return const Mat& windowSize x 1 CV_32F Gaussian kernel
+ */
+const Mat &Utils::GaussianRowKernel(int windowSize, double sigma) {
+	return kernelCache.Get(KernelCache::GAUSSIAN_ROW, windowSize, sigma, [&]() {
+		return getGaussianKernel(windowSize, sigma, CV_32F);
+	});
+}
 
-	return gaussianKernel;
+/**
+ * @brief Computes a zero mean Laplacian of Gaussian kernel
+ * \f[ \text{LoG}(X,Y) = \frac{1}{2 \pi \sigma^2} \exp\left(-\frac{X^2 + Y^2}{2 \sigma^2}\right) \left( \frac{X^2 + Y^2}{\sigma^2} - 2 \right) \f]
+ * The kernel is kept in the kernel cache and must not be modified
+ * @param windowSize size of the window for the kernel
+ * @param sigma standard deviation for the Gaussian distribution
+ * @return const Mat& Laplacian of Gaussian kernel
+ */
+const Mat &Utils::LoGKernel(int windowSize, double sigma) {
+	return kernelCache.Get(KernelCache::LOG, windowSize, sigma, [&]() {
+		// Get the Gaussian kernel
+		const Mat &gaussianKernel = GaussianKernel(windowSize, sigma);
+
+		// Pre computation of meshgrid values
+		Mat X, Y, S;
+		Range range = Range(-(windowSize/2), (windowSize/2) + 1);
+		MeshGrid(range, X, Y);
+		pow(X, 2.0, X);
+		pow(Y, 2.0, Y);
+
+		// Variance
+		double variance = pow(sigma, 2.0);
+		Mat laplacianOfGaussianKernel = (1.0 / (2.0 * CV_PI * variance)) * (((X+Y)/variance) - 2.0).mul(gaussianKernel);
+
+		// Normalization
+		laplacianOfGaussianKernel -= sum(laplacianOfGaussianKernel).val[0] / pow(windowSize, 2.0);
+
+		return laplacianOfGaussianKernel;
+	});
 }
 
 /**
@@ -97,22 +153,7 @@ Mat Utils::GaussianKernel(int windowSize, double sigma) {
  * \f[ \text{LoG}(X,Y) = \frac{1}{2 \pi \sigma^2} \exp\left(-\frac{X^2 + Y^2}{2 \sigma^2}\right) \left( \frac{X^2 + Y^2}{\sigma^2} - 2 \right) \f]
  */
 Mat Utils::LoGFilter(const Mat &image, int windowSize, double sigma) {
-	// Get the Gaussian kernel
-	Mat gaussianKernel = GaussianKernel(windowSize, sigma);
-
-	// Pre computation of meshgrid values
-	Mat X, Y, S;
-	Range range = Range(-(windowSize/2), (windowSize/2) + 1);
-	MeshGrid(range, X, Y);
-	pow(X, 2.0, X);
-	pow(Y, 2.0, Y);
-
-	// Variance
-	double variance = pow(sigma, 2.0);
-	Mat laplacianOfGaussianKernel = (1.0 / (2.0 * CV_PI * variance)) * (((X+Y)/variance) - 2.0).mul(gaussianKernel);
-
-	// Normalization
-	laplacianOfGaussianKernel -= sum(laplacianOfGaussianKernel).val[0] / pow(windowSize, 2.0);
+	const Mat &laplacianOfGaussianKernel = LoGKernel(windowSize, sigma);
 
 	// Create a new image with the size and type of the input image
 	Mat LoGFilteredImage(image.size(), image.type());
@@ -126,67 +167,83 @@ Mat Utils::LoGFilter(const Mat &image, int windowSize, double sigma) {
 /**
  * @brief Applies a regular non adaptive UnSharp mask (USM) filter with a Laplacian of Gaussian filter
  * \f[ \hat{f}_{\text USM} = U + \lambda \ \text{LoG} \text{ where } \text{LoG} = l * g \f]
+ * The Laplacian is normalized so its largest magnitude matches the largest value of the image.
+ * The stage runs in two sweeps over row bands of each CIELab plane. The first one filters each band (the bands
+ * read their halo from the neighbouring rows of their plane, so the result is the same as filtering the whole
+ * plane) and reduces the global extrema while the band is still in cache. The second one applies the normalized
+ * lambda scaling in place over the Laplacian planes, which become the output
  * @param image Input image to filter
  * @param windowSize Size of the filter
  * @param lambda constant for the Laplacian deceive
  * @param sigma standard distribution
  * @return Filtered image
  */
-Mat Utils::NonAdaptiveUSMFilter(const Mat &image, int windowSize, double lambda, double sigma) {
+LabImage Utils::NonAdaptiveUSMFilter(const LabImage &image, int windowSize, double lambda, double sigma) {
 	// Generate the Laplacian kernel
-	Mat LoGFilteredImage = LoGFilter(image, windowSize, sigma);
-
-	// Normalize the Laplacian filtered image
-	double minL, maxL, minI, maxI;
-	Utils::MinMax(abs(LoGFilteredImage), &minL, &maxL);
-	Utils::MinMax(image, &minI, &maxI);
-	LoGFilteredImage = maxI * (LoGFilteredImage / maxL);
-
-	// Return the filtered image
-	return (image - lambda * LoGFilteredImage);
+	const Mat &laplacianOfGaussianKernel = LoGKernel(windowSize, sigma);
+
+	const Size size = image.ImageSize();
+	const int bandRows = 64;
+	const int bands = (size.height + bandRows - 1) / bandRows;
+	LabImage usmImage = FrameWorkspace::AcquireLab(workspace, FrameWorkspace::USM_IMAGE, size);
+
+	// Laplacian of each band and block wise reduction of the max |LoG| and max U
+	float maxL = 0.0f, maxI = -FLT_MAX;
+	#pragma omp parallel for collapse(2) reduction(max: maxL, maxI) shared(image, usmImage, laplacianOfGaussianKernel)
+	for (int c = 0; c < 3; c++) {
+		for (int band = 0; band < bands; band++) {
+			Range rows(band * bandRows, std::min((band + 1) * bandRows, size.height));
+			Mat LoGBand = usmImage.planes[c].rowRange(rows);
+			filter2D(image.planes[c].rowRange(rows), LoGBand, -1, laplacianOfGaussianKernel, Point(-1,-1), 0, BORDER_CONSTANT);
+			for (int i = rows.start; i < rows.end; i++) {
+				const float *imageRow = image.planes[c].ptr<float>(i);
+				const float *LoGRow = usmImage.planes[c].ptr<float>(i);
+				for (int j = 0; j < size.width; j++) {
+					maxL = std::max(maxL, std::abs(LoGRow[j]));
+					maxI = std::max(maxI, imageRow[j]);
+				}
+			}
+		}
+	}
+
+	// A flat image has no Laplacian response
+	const float scale = maxL > 0.0f ? (float) lambda * maxI / maxL : 0.0f;
+	usmScale = scale;
+
+	// Subtract the normalized Laplacian in place
+	#pragma omp parallel for collapse(2) shared(image, usmImage)
+	for (int c = 0; c < 3; c++) {
+		for (int i = 0; i < size.height; i++) {
+			const float *imageRow = image.planes[c].ptr<float>(i);
+			float *usmRow = usmImage.planes[c].ptr<float>(i);
+			for (int j = 0; j < size.width; j++) usmRow[j] = imageRow[j] - scale * usmRow[j];
+		}
+	}
+
+	return usmImage;
 }
 
 /**
- * @brief Computes the Euclidean distance between a fixed patch at the center of the input
- * image and a patch centered in every other pixel in the input image, mathematically, for
- * an input matrix \f$A = (a_{ij})\f$ every element will take the corresponding Euclidean distance value
+ * @brief Computes the Euclidean distance between a fixed patch at the corner of a window
+ * and a patch at every pixel of the window, mathematically, for
+ * an output matrix \f$A = (a_{ij})\f$ every element will take the corresponding Euclidean distance value
  * \f$a_{ij} = d_{ij}^{2} = || x_{i}-x_{j} ||^{2}\f$
- * @param inputImage_ input image
+ * summed over the three CIELab channels. The window is read in place from the planes of a padded frame,
+ * the patches that leave the window replicate its border
+ * @param planes CIELab planes of the padded frame
+ * @param row first row of the window in the planes
+ * @param col first column of the window in the planes
+ * @param windowSize processing window size
  * @param neighborhoodSize size of the pixel neighborhood
- * @return Mat
+ * @param candidates windowSize x windowSize flags of the patches to compare, the others get the largest distance. Can be null
+ * @param distances windowSize x windowSize output matrix, only allocated if it does not fit so it can be reused
  */
-Mat Utils::EuclideanDistancesMatrix(const Mat& inputImage_, int windowSize, int neighborhoodSize) {
-	// Fixed pixel sub region (must be a square region)
-	Mat inputImage;
-	int padding = (windowSize-1)/2;
-	copyMakeBorder(inputImage_, inputImage, padding, padding, padding, padding, BORDER_REPLICATE);
-
-	// Ranges
-	Range xRange, yRange;
-	xRange = Range(windowSize/2, windowSize/2 + neighborhoodSize);
-	yRange = Range(windowSize/2, windowSize/2 + neighborhoodSize);
-
-	// Fixed patch at the center of the image
-	Mat fixedWindow = inputImage(xRange, yRange);
-
-	// Moving pixel sub region
-	Mat slidingWindow(fixedWindow.size(), fixedWindow.type());
-
-	// Initialize the output matrix
-	Mat euclideanDistancesMatrix(inputImage_.size(), inputImage_.type());
-
-	// Visit each pixel in the image region
-	for(int i = 0; i < windowSize; i++) {
-		xRange = Range(i, i + neighborhoodSize);
-		for(int j = 0; j < windowSize; j++) {
-			yRange = Range(j, j + neighborhoodSize);
-
-			//Extract pixel w neighborhood local region
-			slidingWindow = inputImage(xRange, yRange);
-
-			// Calculate the euclidean distance between patches
-			euclideanDistancesMatrix.at<float>(i, j) = (float) norm(fixedWindow, slidingWindow, NORM_L2SQR) / ((float)neighborhoodSize);
-        }
-    }
-    return euclideanDistancesMatrix;
-}
\ No newline at end of file
+void Utils::EuclideanDistancesMatrix(const Mat planes[3], int row, int col, int windowSize, int neighborhoodSize, const unsigned char *candidates, Mat &distances) {
+	CV_Assert(planes[0].type() == CV_32FC1 && planes[0].step == planes[1].step && planes[0].step == planes[2].step);
+
+	distances.create(windowSize, windowSize, CV_32FC1);
+	const float *window[3] = {planes[0].ptr<float>(row) + col, planes[1].ptr<float>(row) + col, planes[2].ptr<float>(row) + col};
+
+	// Compare the fixed patch with the patch of each pixel in the window, the kernel is specialized for the window size
+	Kernels::PatchDistances(window, planes[0].step1(), windowSize, neighborhoodSize, candidates, distances.ptr<float>());
+}
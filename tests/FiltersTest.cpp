@@ -0,0 +1,97 @@
+/**
+ * @file FiltersTest.cpp
+ * @author Isaac Fonseca (isaac.fonsecasegura@ucr.ac.cr)
+ * @date 2026-10-16
+ *
+ */
+
+#include <cstdio>
+#include "Filters.hpp"
+
+/**
+ * @brief Builds a random CIELab image in the ranges of the converter
+ *
+ * @param size image size
+ * @return LabImage random image
+ */
+static LabImage RandomLabImage(Size size) {
+	LabImage image(size);
+	randu(image.planes[0], Scalar(0.0), Scalar(100.0));
+	randu(image.planes[1], Scalar(-50.0), Scalar(50.0));
+	randu(image.planes[2], Scalar(-50.0), Scalar(50.0));
+	return image;
+}
+
+/**
+ * @brief Gets the largest difference between the planes of two images
+ *
+ * @param first first image
+ * @param second second image
+ * @return double largest absolute difference
+ */
+static double MaxDifference(const LabImage &first, const LabImage &second) {
+	double difference = 0.0;
+	for (int c = 0; c < 3; c++) difference = std::max(difference, norm(first.planes[c], second.planes[c], NORM_INF));
+	return difference;
+}
+
+/**
+ * @brief Checks the sliding NLM engine against the exact one. The sliding engine only reorders the sums of the
+ * patch distances, so both agree up to float rounding. The window sizes above 2 * neighborhoodSize have offsets
+ * whose patches leave the window entirely and so have no sliding columns
+ *
+ * @return int number of failed cases
+ */
+static int SlidingMatchesExact() {
+	const int cases[][2] = {{3, 3}, {9, 3}, {11, 5}, {15, 7}, {21, 7}, {21, 5}};
+	const LabImage input = RandomLabImage(Size(37, 23));
+	const LabImage weighting = RandomLabImage(Size(37, 23));
+	int failures = 0;
+
+	for (const auto &sizes : cases) {
+		Filters exact, sliding;
+		sliding.engine = Filters::SLIDING;
+		const LabImage expected = exact.NonLocalMeansFilter(input, weighting, sizes[0], sizes[1], 10.0);
+		const LabImage result = sliding.NonLocalMeansFilter(input, weighting, sizes[0], sizes[1], 10.0);
+		const double difference = MaxDifference(expected, result);
+		if (difference > 1e-3) {
+			std::fprintf(stderr, "SLIDING differs from EXACT by %g with -w %d -n %d\n", difference, sizes[0], sizes[1]);
+			failures++;
+		}
+	}
+	return failures;
+}
+
+/**
+ * @brief Checks the symmetric bilateral filter against the exact one, with and without the range lookup table
+ *
+ * @return int number of failed cases
+ */
+static int SymmetricMatchesExact() {
+	const LabImage input = RandomLabImage(Size(37, 23));
+	const LabImage weighting = RandomLabImage(Size(37, 23));
+	int failures = 0;
+
+	for (int windowSize : {3, 7, 11, 21}) {
+		for (bool rangeLUT : {false, true}) {
+			Filters exact, symmetric;
+			exact.rangeLUT = symmetric.rangeLUT = rangeLUT;
+			symmetric.symmetric = true;
+			const LabImage expected = exact.BilateralFilter(input, weighting, windowSize, 3.0, 30.0);
+			const LabImage result = symmetric.BilateralFilter(input, weighting, windowSize, 3.0, 30.0);
+			const double difference = MaxDifference(expected, result);
+			if (difference > 1e-3) {
+				std::fprintf(stderr, "Symmetric bilateral differs from EXACT by %g with -w %d\n", difference, windowSize);
+				failures++;
+			}
+		}
+	}
+	return failures;
+}
+
+int main() {
+	theRNG().state = 0x5EED;
+	int failures = SlidingMatchesExact() + SymmetricMatchesExact();
+	if (failures) std::fprintf(stderr, "%d failed cases\n", failures);
+	return failures ? 1 : 0;
+}
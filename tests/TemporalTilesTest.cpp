@@ -0,0 +1,152 @@
+/**
+ * @file TemporalTilesTest.cpp
+ * @author Isaac Fonseca (isaac.fonsecasegura@ucr.ac.cr)
+ * @date 2026-10-16
+ *
+ */
+
+#include <cstdio>
+#include <string>
+#include "DeWAFF.hpp"
+
+enum FilterType : int {DBF, DSBF, DNLMF, DGF};
+
+/**
+ * @brief Filter and engine combination accepted by the temporal mode
+ *
+ */
+struct TemporalCase {
+	const char *name;
+	FilterType filter;
+	Filters::Engine engine;
+	bool symmetric;
+	double tolerance; // Largest output difference, 0 for the engines that sum every pixel in the same order
+};
+
+/**
+ * @brief Builds a random CIELab image in the ranges of the converter
+ *
+ * @param size image size
+ * @return LabImage random image
+ */
+static LabImage RandomLabImage(Size size) {
+	LabImage image(size);
+	randu(image.planes[0], Scalar(0.0), Scalar(100.0));
+	randu(image.planes[1], Scalar(-50.0), Scalar(50.0));
+	randu(image.planes[2], Scalar(-50.0), Scalar(50.0));
+	return image;
+}
+
+/**
+ * @brief Applies the filter of a case to a frame
+ *
+ * @param framework framework configured for the case
+ * @param filter filter to apply
+ * @param frame CIELab frame
+ * @return LabImage filtered frame
+ */
+static LabImage Apply(DeWAFF &framework, FilterType filter, const LabImage &frame) {
+	switch (filter) {
+		case DBF: return framework.DeceivedBilateralFilter(frame, 11, 3.0, 20.0);
+		case DSBF: return framework.DeceivedScaledBilateralFilter(frame, 11, 3.0, 20.0);
+		case DNLMF: return framework.DeceivedNonLocalMeansFilter(frame, 11, 5, 3.0, 20.0);
+		default: return framework.DeceivedGuidedFilter(frame, 11, 3.0, 15.0);
+	}
+}
+
+/**
+ * @brief Checks that a temporal run with a zero tolerance matches filtering every frame whole. The second frame
+ * only changes in a small region, so most of its tiles reuse the first output and the rest are filtered on crops.
+ * The changed regions include the frame corners, where the crops are clipped to the frame.
+ * The USM is disabled, so its Laplacian scale does not force a whole frame
+ *
+ * @return int number of failed cases
+ */
+static int TiledMatchesWhole() {
+	const TemporalCase cases[] = {
+		{"dbf exact", DBF, Filters::EXACT, false, 0.0},
+		{"dbf exact sym", DBF, Filters::EXACT, true, 1e-2},
+		{"dsbf exact", DSBF, Filters::EXACT, false, 1e-2},
+		{"dnlmf exact", DNLMF, Filters::EXACT, false, 0.0},
+		{"dnlmf sliding", DNLMF, Filters::SLIDING, false, 0.0},
+		{"dnlmf integral", DNLMF, Filters::INTEGRAL, false, 1e-2},
+		{"dnlmf integral sym", DNLMF, Filters::INTEGRAL, true, 1e-2},
+		{"dgf", DGF, Filters::EXACT, false, 1e-2}
+	};
+	const Size size(256, 192);
+	const Rect changes[] = {Rect(40, 40, 16, 12), Rect(0, 0, 20, 10), Rect(size.width - 24, size.height - 12, 24, 12)};
+
+	int failures = 0;
+	for (const Rect &change : changes) {
+		// Tile tracking works on the 8 bit frames, the filters on their CIELab images
+		Mat firstFrame(size, CV_8UC3), secondFrame;
+		randu(firstFrame, Scalar::all(0), Scalar::all(256));
+		secondFrame = firstFrame.clone();
+		Mat changedFrame = secondFrame(change);
+		randu(changedFrame, Scalar::all(0), Scalar::all(256));
+		const LabImage first = RandomLabImage(size);
+		const LabImage second = first.Clone();
+		LabImage changed = second.Crop(change);
+		RandomLabImage(change.size()).CopyTo(changed);
+
+		for (const TemporalCase &test : cases) {
+			TemporalTiles tiles;
+			tiles.tolerance = 0.0;
+			DeWAFF tiled, whole;
+			for (DeWAFF *framework : {&tiled, &whole}) {
+				framework->usmLambda = 0.0;
+				framework->filtersLib.engine = test.engine;
+				framework->filtersLib.symmetric = test.symmetric;
+			}
+			tiled.temporalTiles = &tiles;
+
+			tiles.Update(firstFrame);
+			Apply(tiled, test.filter, first);
+			tiles.Update(secondFrame);
+			const LabImage result = Apply(tiled, test.filter, second).Clone();
+			const LabImage expected = Apply(whole, test.filter, second);
+
+			double difference = 0.0;
+			for (int c = 0; c < 3; c++) difference = std::max(difference, norm(expected.planes[c], result.planes[c], NORM_INF));
+			if (difference > test.tolerance) {
+				std::fprintf(stderr, "%s at (%d, %d): the temporal output differs by %g\n", test.name, change.x, change.y, difference);
+				failures++;
+			}
+		}
+	}
+	return failures;
+}
+
+/**
+ * @brief Checks that the subsampled guided filter is refused in the temporal mode, its resampling grid would start
+ * at each crop instead of the frame origin
+ *
+ * @return int number of failed cases
+ */
+static int SubsampledGuidedRejected() {
+	const Size size(64, 48);
+	Mat frame(size, CV_8UC3);
+	randu(frame, Scalar::all(0), Scalar::all(256));
+	TemporalTiles tiles;
+	tiles.Update(frame);
+	DeWAFF framework;
+	framework.usmLambda = 0.0;
+	framework.filtersLib.guidedSubsampling = 2;
+	framework.temporalTiles = &tiles;
+	try {
+		Apply(framework, DGF, RandomLabImage(size));
+	} catch (const cv::Exception &) {
+		return 0;
+	}
+	std::fprintf(stderr, "dgf sub 2: the temporal mode accepted a subsampled guided filter\n");
+	return 1;
+}
+
+int main() {
+	// The scalar kernels evaluate every pixel alike, the vector ones depend on the lane of the pixel in the crop
+	Kernels::SetISA(Kernels::SCALAR);
+	theRNG().state = 0x5EED;
+	int failures = TiledMatchesWhole() + SubsampledGuidedRejected();
+	if (failures) std::fprintf(stderr, "%d failed cases\n", failures);
+	return failures ? 1 : 0;
+}